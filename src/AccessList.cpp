@@ -0,0 +1,189 @@
+/*
+ * AccessList.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 14, 2018
+ *      Author: chris.l
+ */
+
+#include "hal/HAL.h"
+#include "AccessList.h"
+#include "Log.h"
+
+static const char* TAG = "AccessList";
+
+static const char* const action_names[] = {"serve", "ignore", "kod", "nomonitor", "query"};
+
+#define ACTION_COUNT (sizeof(action_names) / sizeof(action_names[0]))
+
+static uint32_t prefixMask(uint8_t prefix)
+{
+    return prefix == 0 ? 0 : 0xffffffffUL << (32 - prefix);
+}
+
+AccessList::AccessList() : _start(), _action(), _ranges(0)
+{
+    reset();
+}
+
+AccessList::~AccessList()
+{
+}
+
+/*
+ * No rules, everyone is served.
+ */
+void AccessList::reset()
+{
+    _start[0]  = 0;
+    _action[0] = ACCESS_SERVE;
+    _ranges    = 1;
+}
+
+/*
+ * Replace the rules.  Every prefix starts a range at its first address
+ * and ends it after its last, between those boundaries the set of
+ * matching rules (so the action) does not change.  Returns false and
+ * keeps the old rules if one is bad.
+ */
+bool AccessList::set(const AccessRule* rules, unsigned count)
+{
+    if (count > ACCESS_RULES_MAX)
+    {
+        dlog.error(TAG, F("set: %u rules, at most %u"), count, ACCESS_RULES_MAX);
+        return false;
+    }
+
+    uint32_t bounds[ACCESS_RANGES_MAX];
+    unsigned nbounds = 0;
+    bounds[nbounds++] = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (rules[i].prefix > 32 || rules[i].action >= ACTION_COUNT)
+        {
+            dlog.error(TAG, F("set: bad rule %u prefix:%u action:%u"), i, rules[i].prefix, rules[i].action);
+            return false;
+        }
+
+        uint32_t mask     = prefixMask(rules[i].prefix);
+        uint32_t first    = rules[i].addr & mask;
+        uint32_t last     = first | ~mask;
+        uint32_t edges[2] = {first, last + 1};  // past the end wraps to 0, which is already there
+        for (uint32_t edge : edges)
+        {
+            unsigned at = 0;
+            while (at < nbounds && bounds[at] < edge)
+            {
+                ++at;
+            }
+            if (at < nbounds && bounds[at] == edge)
+            {
+                continue;
+            }
+            memmove(&bounds[at+1], &bounds[at], (nbounds - at) * sizeof(bounds[0]));
+            bounds[at] = edge;
+            ++nbounds;
+        }
+    }
+
+    _ranges = 0;
+    for (unsigned b = 0; b < nbounds; ++b)
+    {
+        int     best   = -1;
+        uint8_t action = ACCESS_SERVE;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (((bounds[b] ^ rules[i].addr) & prefixMask(rules[i].prefix)) == 0 && (int)rules[i].prefix > best)
+            {
+                best   = rules[i].prefix;
+                action = rules[i].action;
+            }
+        }
+
+        if (_ranges == 0 || _action[_ranges-1] != action)
+        {
+            _start[_ranges]  = bounds[b];
+            _action[_ranges] = action;
+            ++_ranges;
+        }
+    }
+
+    dlog.info(TAG, F("set: %u rules in %u ranges"), count, _ranges);
+    return true;
+}
+
+AccessAction AccessList::check(uint32_t addr)
+{
+    uint32_t host = ntohl(addr);
+    unsigned lo   = 0;          // the range is in [lo, hi)
+    unsigned hi   = _ranges;
+    while (hi - lo > 1)
+    {
+        unsigned mid = (lo + hi) / 2;
+        if (_start[mid] <= host)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return (AccessAction)_action[lo];
+}
+
+/*
+ * "a.b.c.d/prefix action", action one of serve, ignore, kod, nomonitor or
+ * query.
+ */
+bool AccessList::parse(const char* text, AccessRule* rule)
+{
+    unsigned a, b, c, d, prefix;
+    char     name[12];
+    if (sscanf(text, "%u.%u.%u.%u/%u %11s", &a, &b, &c, &d, &prefix, name) != 6
+            || a > 255 || b > 255 || c > 255 || d > 255 || prefix > 32)
+    {
+        dlog.error(TAG, F("parse: bad rule '%s'"), text);
+        return false;
+    }
+
+    for (unsigned i = 0; i < ACTION_COUNT; ++i)
+    {
+        if (strcmp(name, action_names[i]) == 0)
+        {
+            rule->addr   = (a << 24) | (b << 16) | (c << 8) | d;
+            rule->prefix = (uint8_t)prefix;
+            rule->action = (uint8_t)i;
+            return true;
+        }
+    }
+
+    dlog.error(TAG, F("parse: unknown action '%s'"), name);
+    return false;
+}
+
+void AccessList::format(const AccessRule& rule, char* text, size_t size)
+{
+    snprintf(text, size, "%u.%u.%u.%u/%u %s",
+            (unsigned)(rule.addr >> 24), (unsigned)(rule.addr >> 16) & 0xff,
+            (unsigned)(rule.addr >> 8) & 0xff, (unsigned)rule.addr & 0xff,
+            rule.prefix, getActionName(rule.action));
+}
+
+const char* AccessList::getActionName(uint8_t action)
+{
+    return action < ACTION_COUNT ? action_names[action] : "?";
+}
@@ -0,0 +1,80 @@
+/*
+ * AccessList.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 14, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ACCESSLIST_H_
+#define ACCESSLIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ACCESS_RULES_MAX    16    // rules in the config
+#define ACCESS_RANGES_MAX   (2 * ACCESS_RULES_MAX + 1)  // each rule splits at most one range in three
+#define ACCESS_TEXT_SIZE    32    // "255.255.255.255/32 nomonitor"
+
+typedef enum
+{
+    ACCESS_SERVE,       // answer (and rate limit) it
+    ACCESS_IGNORE,      // drop it without a word
+    ACCESS_KOD,         // send a DENY Kiss-o'-Death
+    ACCESS_NOMONITOR,   // answer it but leave it out of the client table and its rate limit
+    ACCESS_QUERY        // serve it and also answer its mode 6 (MRU list) queries, nobody else may
+} AccessAction;
+
+typedef struct access_rule
+{
+    uint32_t addr;      // host byte order
+    uint8_t  prefix;    // leading bits of addr that must match, 0..32
+    uint8_t  action;    // AccessAction
+} AccessRule;
+
+//
+// Restrict/allow rules as "address/prefix action", the most specific
+// prefix that matches an address decides (ties go to the earlier rule) and
+// an address no rule matches is served.
+//
+// set() flattens the rules into the disjoint address ranges they carve
+// out, in order, each with its action and neighbours with the same action
+// merged.  check() is then a binary search of at most ACCESS_RANGES_MAX
+// start addresses, with no rules it is one compare.
+//
+class AccessList
+{
+public:
+    AccessList();
+    virtual ~AccessList();
+
+    void          reset();
+    bool          set(const AccessRule* rules, unsigned count);
+    AccessAction  check(uint32_t addr);     // addr in network byte order
+
+    unsigned      getRanges() { return _ranges; }
+
+    static bool   parse(const char* text, AccessRule* rule);
+    static void   format(const AccessRule& rule, char* text, size_t size);
+    static const char* getActionName(uint8_t action);
+
+private:
+    uint32_t _start[ACCESS_RANGES_MAX];     // first address of each range, ascending, _start[0] is 0
+    uint8_t  _action[ACCESS_RANGES_MAX];    // and what to do with it
+    unsigned _ranges;
+};
+
+#endif /* ACCESSLIST_H_ */
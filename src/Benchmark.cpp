@@ -0,0 +1,665 @@
+/*
+ * Benchmark.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Jul 14, 2018
+ *      Author: chris.l
+ */
+
+#include "Benchmark.h"
+
+#if defined(BENCHMARK)
+
+#include <algorithm>
+#include "hal/HAL.h"
+#include "Timestamp.h"
+#include "SeqLock.h"
+#include "NMEAParser.h"
+#include "UBX.h"
+#include "GPS.h"
+#include "NTP.h"
+#if defined(ARDUINO)
+#include "hal/esp8266/ESPTimer.h"
+#else
+#include <atomic>
+#include <thread>
+#include <time.h>
+#include "hal/posix/PosixTimer.h"
+#endif
+
+#include "Log.h"
+static const char* TAG = "Benchmark";
+
+static volatile uint32_t sink; // keeps the compiler from optimizing the work away
+
+//
+// step through the microseconds with a stride that is relatively prime to 10^6,
+// the empty asm hides the value from the optimizer so each conversion is
+// done from scratch instead of being strength reduced across iterations.
+//
+#define NEXT_US(us) {us += 997; if (us >= MICROS_PER_SEC) us -= MICROS_PER_SEC; __asm__ __volatile__("" : "+r" (us));}
+
+static uint32_t loopCycles()
+{
+    uint32_t us    = 0;
+    uint32_t start = hal::cycles();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; ++i)
+    {
+        sink = us;
+        NEXT_US(us);
+    }
+    return hal::cycles() - start;
+}
+
+/*
+ * Cycles per unit in hundredths, print as "%lu.%02lu" with HUNDREDTHS().
+ * On the host a byte or a conversion can take less than one emulated
+ * cycle.
+ */
+static uint32_t hundredths(uint32_t cycles, uint32_t count)
+{
+    return (uint32_t)((uint64_t)cycles * 100 / count);
+}
+
+#define HUNDREDTHS(h) (unsigned long)((h) / 100), (unsigned long)((h) % 100)
+
+static void logConversion(const char* name, uint32_t cycles, uint32_t overhead)
+{
+    uint32_t h = hundredths(cycles > overhead ? cycles - overhead : 0, BENCHMARK_ITERATIONS);
+    dlog.info(TAG, F("%s %lu.%02lu cycles/conversion"), name, HUNDREDTHS(h));
+}
+
+static void benchmarkTimestamp()
+{
+    uint32_t overhead = loopCycles();
+    uint32_t us       = 0;
+    uint32_t start    = hal::cycles();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; ++i)
+    {
+        sink = (uint32_t)(((double)us/(double)MICROS_PER_SEC) * (double)4294967296L);
+        NEXT_US(us);
+    }
+    uint32_t fp_cycles = hal::cycles() - start;
+
+    us    = 0;
+    start = hal::cycles();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; ++i)
+    {
+        sink = us2frac(us);
+        NEXT_US(us);
+    }
+    uint32_t int_cycles = hal::cycles() - start;
+
+    us    = 0;
+    start = hal::cycles();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; ++i)
+    {
+        sink = frac2us(us);
+        NEXT_US(us);
+    }
+    uint32_t rev_cycles = hal::cycles() - start;
+
+    logConversion("us->frac double: ", fp_cycles, overhead);
+    logConversion("us->frac integer:", int_cycles, overhead);
+    logConversion("frac->us integer:", rev_cycles, overhead);
+
+    //
+    // verify the round trip is exact for every microsecond
+    //
+    uint32_t errors = 0;
+    for (us = 0; us < MICROS_PER_SEC; ++us)
+    {
+        if (frac2us(us2frac(us)) != us)
+        {
+            ++errors;
+        }
+        if ((us & 0xffff) == 0)
+        {
+            hal::yield();
+        }
+    }
+    dlog.info(TAG, F("us->frac->us round trip errors: %lu"), errors);
+}
+
+//
+// Seqlock stress: a writer publishes a set of values with an invariant
+// while we hammer reads, none may be torn.  On the device the writer is
+// timer1 firing every SEQ_WRITE_US, on the host a thread writing flat out
+// on another core, which also checks the barriers.
+//
+#define SEQ_WRITE_US 25
+#define SEQ_READS    1000000
+
+typedef struct seq_test
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+} SeqTest;
+
+static SeqLock<SeqTest>  seq_test;
+static volatile uint32_t seq_writes;
+
+static void ICACHE_RAM_ATTR seqWriter()
+{
+    uint32_t n = ++seq_writes;
+    SeqTest& t = seq_test.beginWrite();
+    t.a = n;
+    t.b = ~n;
+    t.c = n * 7919;
+    t.d = n ^ 0x5a5a5a5a;
+    seq_test.endWrite();
+}
+
+#if !defined(ARDUINO)
+static std::atomic<bool> seq_stop;
+
+static void seqWriterThread()
+{
+    while (!seq_stop.load(std::memory_order_relaxed))
+    {
+        seqWriter();
+    }
+}
+#endif
+
+static void benchmarkSeqLock()
+{
+    seq_writes = 0;
+    seqWriter();    // the zeroed initial values would fail the check
+#if defined(ARDUINO)
+    timer1_attachInterrupt(seqWriter);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);  // 5MHz ticks
+    timer1_write(SEQ_WRITE_US * 5);
+#else
+    seq_stop = false;
+    std::thread writer(seqWriterThread);
+#endif
+
+    uint32_t torn  = 0;
+    uint32_t start = hal::cycles();
+    for (uint32_t i = 0; i < SEQ_READS; ++i)
+    {
+        SeqTest t;
+        seq_test.read(&t);
+        if (t.b != ~t.a || t.c != t.a * 7919 || t.d != (t.a ^ 0x5a5a5a5a))
+        {
+            ++torn;
+        }
+        if ((i & 0xffff) == 0)
+        {
+            hal::yield();
+        }
+    }
+    uint32_t cycles = hal::cycles() - start;
+
+#if defined(ARDUINO)
+    timer1_disable();
+    timer1_detachInterrupt();
+#else
+    seq_stop = true;
+    writer.join();
+#endif
+
+    dlog.info(TAG, F("seqlock: reads:%lu writes:%lu retries:%lu torn:%lu cycles/read:%lu.%02lu"),
+            (unsigned long)SEQ_READS, seq_writes, seq_test.getRetries(), torn, HUNDREDTHS(hundredths(cycles, SEQ_READS)));
+}
+
+//
+// One second of output recorded from a u-blox NEO-6M (plus a ZDA).
+//
+static const char nmea_capture[] PROGMEM =
+    "$GPRMC,183035.00,A,3723.46587,N,12202.26957,W,0.011,,140718,,,A*64\r\n"
+    "$GPVTG,,T,,M,0.011,N,0.020,K,A*21\r\n"
+    "$GPGGA,183035.00,3723.46587,N,12202.26957,W,1,08,1.01,15.2,M,-29.9,M,,*52\r\n"
+    "$GPGSA,A,3,10,32,14,18,11,24,20,15,,,,,1.85,1.01,1.55*03\r\n"
+    "$GPGSV,3,1,11,08,14,048,,10,56,297,31,11,15,167,29,14,44,201,33*7F\r\n"
+    "$GPGSV,3,2,11,15,14,321,25,18,63,063,35,20,37,295,28,24,20,313,23*77\r\n"
+    "$GPGSV,3,3,11,27,02,042,,32,19,245,30,51,44,183,*4F\r\n"
+    "$GPGLL,3723.46587,N,12202.26957,W,183035.00,A,A*76\r\n"
+    "$GPZDA,183035.00,14,07,2018,00,00*63\r\n";
+
+#define NMEA_PASSES 100
+
+static void benchmarkNMEA()
+{
+    size_t len = strlen_P(nmea_capture);
+    char*  data = (char*)malloc(len);
+    if (data == nullptr)
+    {
+        dlog.error(TAG, F("nmea: no memory for capture"));
+        return;
+    }
+    memcpy_P(data, nmea_capture, len);
+
+    NMEAParser parser;
+    uint32_t   parser_times = 0;
+    uint32_t   start        = hal::cycles();
+    for (int pass = 0; pass < NMEA_PASSES; ++pass)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (parser.process(data[i]) && parser.hasTime())
+            {
+                sink = parser.getTime();
+                ++parser_times;
+            }
+        }
+    }
+    uint32_t parser_cycles = hal::cycles() - start;
+    free(data);
+
+    dlog.info(TAG, F("nmea: %u bytes x %d: NMEAParser %lu.%02lu cycles/byte (%lu times, %lu skipped)"),
+            len, NMEA_PASSES, HUNDREDTHS(hundredths(parser_cycles, len * NMEA_PASSES)), parser_times, parser.getSkipped());
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 118;
+    tm.tm_mon  = 6;
+    tm.tm_mday = 14;
+    start = hal::cycles();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; ++i)
+    {
+        tm.tm_mday = 1 + (i & 15);
+        tm.tm_sec  = 0;
+        sink = mktime(&tm);
+    }
+    uint32_t mktime_cycles = hal::cycles() - start;
+    start = hal::cycles();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; ++i)
+    {
+        sink = NMEAParser::daysFromCivil(2018, 7, 1 + (i & 15)) * 86400;
+    }
+    uint32_t civil_cycles = hal::cycles() - start;
+    dlog.info(TAG, F("nmea: mktime %lu.%02lu cycles daysFromCivil %lu.%02lu cycles"),
+            HUNDREDTHS(hundredths(mktime_cycles, BENCHMARK_ITERATIONS)),
+            HUNDREDTHS(hundredths(civil_cycles, BENCHMARK_ITERATIONS)));
+}
+
+//
+// One second of the UBX timing output of a u-blox M8 after GPS::configure():
+// TIM-TP (qErr -1234ps) followed by NAV-TIMEUTC (2018-07-14 18:30:35).
+//
+static const uint8_t ubx_capture[] PROGMEM =
+{
+    0xb5, 0x62, 0x0d, 0x01, 0x10, 0x00, 0x90, 0x6f, 0x92, 0x18, 0x00, 0x00, 0x00, 0x00, 0x2e, 0xfb,
+    0xff, 0xff, 0xd9, 0x07, 0x03, 0x00, 0xd1, 0xad,
+    0xb5, 0x62, 0x01, 0x21, 0x14, 0x00, 0xa8, 0x6b, 0x92, 0x18, 0x19, 0x00, 0x00, 0x00, 0x81, 0xff,
+    0xff, 0xff, 0xe2, 0x07, 0x07, 0x0e, 0x12, 0x1e, 0x23, 0x07, 0xe2, 0xd2
+};
+
+#define UBX_PASSES 1000
+
+static void benchmarkUBX()
+{
+    uint8_t data[sizeof(ubx_capture)];
+    memcpy_P(data, ubx_capture, sizeof(data));
+
+    UBX      ubx;
+    uint32_t times  = 0;
+    uint32_t qerrs  = 0;
+    uint32_t start  = hal::cycles();
+    for (int pass = 0; pass < UBX_PASSES; ++pass)
+    {
+        for (size_t i = 0; i < sizeof(data); ++i)
+        {
+            if (ubx.process(data[i]))
+            {
+                time_t  time;
+                int32_t qerr;
+                if (ubx.getTimeUTC(&time))
+                {
+                    sink = time;
+                    ++times;
+                }
+                else if (ubx.getQuantizationError(&qerr))
+                {
+                    sink = ps2frac(qerr);
+                    ++qerrs;
+                }
+            }
+        }
+    }
+    uint32_t cycles = hal::cycles() - start;
+
+    dlog.info(TAG, F("ubx: %u bytes x %d: %lu.%02lu cycles/byte %lu.%02lu cycles/second of output (%lu times, %lu qErr, %lu errors)"),
+            sizeof(data), UBX_PASSES, HUNDREDTHS(hundredths(cycles, sizeof(data) * UBX_PASSES)),
+            HUNDREDTHS(hundredths(cycles, UBX_PASSES)), times, qerrs, ubx.getErrors());
+}
+
+//
+// Stand-ins for the parts of the HAL the hot paths don't care about, the
+// serial port replays the NMEA capture with a '$' stamp of "now".
+//
+class BenchFileSystem : public hal::FileSystem
+{
+public:
+    bool begin() override                                    { return true; }
+    bool format() override                                   { return true; }
+    bool exists(const char*) override                        { return false; }
+    int  read(const char*, char*, size_t) override           { return -1; }
+    bool write(const char*, const char*, size_t) override    { return false; }
+    void list(std::function<void(const char*, size_t)>) override {}
+};
+
+class BenchPin : public hal::PinInterrupt
+{
+public:
+    void attach(std::function<void()>) override {}
+    void detach() override {}
+};
+
+class BenchSerial : public hal::SerialPort
+{
+public:
+    BenchSerial(const char* data, size_t len) : _data(data), _len(len), _pos(0), _index(0) {}
+
+    void     rewind()                                  { _pos = 0; }
+    int      available() override                      { return (int)(_len - _pos); }
+    int      read() override
+    {
+        if (_pos >= _len)
+        {
+            return -1;
+        }
+        ++_index;
+        return (uint8_t)_data[_pos++];
+    }
+    size_t   read(char* buffer, size_t size) override
+    {
+        size_t count = MIN(size, _len - _pos);
+        memcpy(buffer, _data + _pos, count);
+        _pos   += count;
+        _index += count;
+        return count;
+    }
+    size_t   write(const uint8_t*, size_t len) override { return len; }
+    void     flush() override                           {}
+    void     setBaud(uint32_t) override                 {}
+    uint32_t getBaud() override                         { return 9600; }
+    uint32_t getReadIndex() override                    { return _index; }
+    bool     getStamp(uint32_t, uint32_t* cycles) override { *cycles = hal::cycles(); return true; }
+    uint32_t getOverflows() override                    { return 0; }
+    uint32_t getFIFOOverflows() override                { return 0; }
+    uint32_t getStampOverflows() override               { return 0; }
+
+private:
+    const char* _data;
+    size_t      _len;
+    size_t      _pos;
+    uint32_t    _index;
+};
+
+class BenchUDPPacket : public hal::UDPPacket
+{
+public:
+    BenchUDPPacket(const NTPPacket& request, uint32_t addr) : _request(request), _reply(), _addr(addr), _rx_cycles(hal::cycles()) {}
+
+    size_t         length() override { return sizeof(_request); }
+    const uint8_t* data() override   { return (const uint8_t*)&_request; }
+    size_t         write(const uint8_t* data, size_t len) override
+    {
+        len = MIN(len, sizeof(_reply));
+        memcpy(&_reply, data, len);
+        return len;
+    }
+    uint8_t*       edit() override   { return (uint8_t*)&_request; }
+    size_t         reply() override  { return sizeof(_request); }  // it is already where a socket would send it from
+    uint32_t       remoteIP() override { return _addr; }
+    uint32_t       rxCycles() override { return _rx_cycles; }
+
+private:
+    NTPPacket _request;
+    NTPPacket _reply;
+    uint32_t  _addr;
+    uint32_t  _rx_cycles;
+};
+
+class BenchUDPEndpoint : public hal::UDPEndpoint
+{
+public:
+    bool listen(uint16_t) override                                 { return true; }
+    void close() override                                          {}
+    void onPacket(hal::UDPHandler, void*) override                 {}
+};
+
+#if defined(ARDUINO)
+extern void logTimeFirst(DLogBuffer& buffer, DLogLevel level);
+#endif
+
+//
+// The timing and packet hot paths, each timed as BENCHMARK_SAMPLES batches
+// of BENCHMARK_BATCH calls and reported as min/median/max cycles per call.
+// A friend of GPS and NTP so it can reach the private ones and set up a
+// valid snapshot without waiting for real PPS edges.
+//
+class Benchmark
+{
+public:
+    static void hotPaths();
+
+private:
+    template<typename Op>
+    static void measure(const char* name, uint32_t batch, Op op);
+    static void prime(GPS& gps);
+};
+
+/*
+ * Time 'op', the cost of reading the cycle counter is taken out.
+ */
+template<typename Op>
+void Benchmark::measure(const char* name, uint32_t batch, Op op)
+{
+    uint32_t overhead = UINT32_MAX;
+    for (int i = 0; i < BENCHMARK_SAMPLES; ++i)
+    {
+        uint32_t start = hal::cycles();
+        overhead = MIN(overhead, hal::cycles() - start);
+    }
+
+    uint32_t samples[BENCHMARK_SAMPLES];
+    for (int i = 0; i < BENCHMARK_SAMPLES; ++i)
+    {
+        uint32_t start = hal::cycles();
+        for (uint32_t j = 0; j < batch; ++j)
+        {
+            op();
+        }
+        uint32_t cycles = hal::cycles() - start;
+        samples[i] = hundredths(cycles > overhead ? cycles - overhead : 0, batch);
+        hal::yield();
+    }
+    std::sort(samples, samples + BENCHMARK_SAMPLES);
+
+    dlog.info(TAG, F("%-16s cycles/call min:%lu.%02lu median:%lu.%02lu max:%lu.%02lu"), name,
+            HUNDREDTHS(samples[0]), HUNDREDTHS(samples[BENCHMARK_SAMPLES/2]),
+            HUNDREDTHS(samples[BENCHMARK_SAMPLES-1]));
+}
+
+/*
+ * Valid at the time of the NMEA capture with the last edge "now", so the
+ * labels agree and getTime() interpolates the way it does in service.
+ */
+void Benchmark::prime(GPS& gps)
+{
+    PPSSnapshot& s   = gps._state.beginWrite();
+    s.seconds        = NMEAParser::daysFromCivil(2018, 7, 14) * 86400 + 18 * 3600 + 30 * 60 + 35;
+    s.edge_cycles    = hal::cycles();
+    s.cycles_per_sec = CYCLES_PER_SEC;
+    s.frac_scale     = FRAC_SCALE(CYCLES_PER_SEC);
+    s.qerr_frac      = 0;
+    s.valid          = true;
+    s.holdover       = false;
+    gps._state.endWrite();
+    gps._gps_valid   = true;
+    gps._interval    = CYCLES_PER_SEC;
+}
+
+void Benchmark::hotPaths()
+{
+    size_t len  = strlen_P(nmea_capture);
+    char*  nmea = (char*)malloc(len);
+    if (nmea == nullptr)
+    {
+        dlog.error(TAG, F("hot paths: no memory for capture"));
+        return;
+    }
+    memcpy_P(nmea, nmea_capture, len);
+
+    BenchFileSystem  fs;
+    Config           config(fs);
+    BenchSerial      serial(nmea, len);
+    BenchPin         pin;
+#if defined(ARDUINO)
+    hal::ESPTimer    timer;
+#else
+    hal::PosixTimer  timer;
+#endif
+    GPS              gps(serial, pin, timer, config);
+    BenchUDPEndpoint udp;
+    NTP              ntp(gps, udp);
+
+    prime(gps);
+
+    measure("GPS::getTime", BENCHMARK_BATCH, [&]() {
+        Timestamp ts;
+        gps.getTime(&ts);
+        sink = TS_FRACTION(ts);
+    });
+
+    measure("NTP::getNTPTime", BENCHMARK_BATCH, [&]() {
+        NTPTime t;
+        ntp.getNTPTime(&t);
+        sink = t.fraction;
+    });
+
+    NTPPacket request;
+    memset(&request, 0, sizeof(request));
+    request.flags              = (4 << 3) | 3;  // version 4, client
+    request.xmit_time.seconds  = htonl(0xdeadbeef);
+    request.xmit_time.fraction = htonl(0x01234567);
+    //
+    // every request from a new client, so each one is answered and takes
+    // the client table's worst path (replacing an entry)
+    //
+    uint32_t client = 0;
+    measure("NTP::ntp", BENCHMARK_BATCH, [&]() {
+        BenchUDPPacket packet(request, htonl(0x0a000000 | (++client & 0x00ffffff)));
+        ntp.ntp(packet);
+    });
+
+    //
+    // a request the access list turns away, what foreign traffic costs us
+    //
+    AccessRule ignore_all = {0, 0, ACCESS_IGNORE};
+    ntp.setAccess(&ignore_all, 1);
+    measure("NTP::ntp ignored", BENCHMARK_BATCH, [&]() {
+        BenchUDPPacket packet(request, htonl(0x0a000000 | (++client & 0x00ffffff)));
+        ntp.ntp(packet);
+    });
+    ntp.setAccess(nullptr, 0);
+
+    //
+    // the lookup alone against more and more rules: /16s spread over 10/8
+    // that alternate between two actions, so none merge and each adds two
+    // ranges
+    //
+    AccessList access;
+    AccessRule rules[ACCESS_RULES_MAX];
+    for (unsigned count = 0; count <= ACCESS_RULES_MAX; count = count == 0 ? 1 : count * 2)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            rules[i].addr   = 0x0a000000 | ((i * 13 + 1) & 0xff) << 16;
+            rules[i].prefix = 16;
+            rules[i].action = (i & 1) ? ACCESS_IGNORE : ACCESS_NOMONITOR;
+        }
+        access.set(rules, count);
+
+        char name[24];
+        snprintf(name, sizeof(name), "access %2u rules", count);
+        measure(name, BENCHMARK_BATCH, [&]() {
+            sink = access.check(htonl(0x0a000000 | ((++client * 0x010101) & 0x00ffffff)));
+        });
+    }
+
+    //
+    // one second of receiver output through the serial drain, the '$'
+    // stamps, the parser and the labelling.  The first passes see no
+    // satellites yet and log, they are not what we want to time.
+    //
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        serial.rewind();
+        gps.process();
+    }
+    prime(gps);
+    measure("GPS::process", 1, [&]() {
+        serial.rewind();
+        gps.process();
+    });
+    dlog.info(TAG, F("%-16s is one second of NMEA (%u bytes)"), "", (unsigned)len);
+
+    //
+    // back to back edges take the steady state path (seconds, interval
+    // checks, re-arming the validity timer)
+    //
+    prime(gps);
+    measure("GPS::pps", BENCHMARK_BATCH, [&]() {
+        gps.pps();
+    });
+    timer.stop();
+
+#if defined(ARDUINO)
+    measure("logTimeFirst", BENCHMARK_BATCH, [&]() {
+        DLogBuffer buffer;
+        logTimeFirst(buffer, DLogLevel::DLOG_LEVEL_INFO);
+    });
+#else
+    //
+    // the host log has no DLogBuffer or prefix hook, time the same work
+    // (read the clock, break it down, format it) into a plain buffer
+    //
+    measure("logTimeFirst", BENCHMARK_BATCH, [&]() {
+        char      buffer[80];
+        Timestamp ts;
+        struct tm tm;
+        gps.getTime(&ts);
+        time_t seconds = toEPOCH(TS_SECONDS(ts));
+        gmtime_r(&seconds, &tm);
+        snprintf(buffer, sizeof(buffer), "%04d/%02d/%02d %02d:%02d:%02d.%06lu ",
+                tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                (unsigned long)frac2us(TS_FRACTION(ts)));
+        sink = (uint8_t)buffer[0];
+    });
+#endif
+
+    free(nmea);
+}
+
+void benchmark()
+{
+    dlog.info(TAG, F("starting, %d iterations per test"), BENCHMARK_ITERATIONS);
+    benchmarkTimestamp();
+    benchmarkSeqLock();
+    benchmarkNMEA();
+    benchmarkUBX();
+    Benchmark::hotPaths();
+    dlog.info(TAG, F("done"));
+}
+
+#endif
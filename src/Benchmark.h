@@ -0,0 +1,44 @@
+/*
+ * Benchmark.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Jul 14, 2018
+ *      Author: chris.l
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+//
+// Built into the device only with -DBENCHMARK (see the 'benchmark' env in
+// platformio.ini), it runs once from setup() and logs the results.  The
+// native build always has it, "espntp bench".
+//
+#if !defined(ARDUINO) && !defined(BENCHMARK)
+#define BENCHMARK
+#endif
+
+#if defined(BENCHMARK)
+
+#define BENCHMARK_ITERATIONS 10000
+#define BENCHMARK_SAMPLES    101  // timed batches per hot path test, odd so there is a middle one
+#define BENCHMARK_BATCH      100  // calls timed together in one sample
+
+void benchmark();
+
+#endif
+
+#endif /* BENCHMARK_H_ */
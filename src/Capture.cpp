@@ -0,0 +1,322 @@
+/*
+ * Capture.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 8, 2018
+ *      Author: chris.l
+ */
+
+#include "Capture.h"
+
+static inline void put32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static inline uint32_t get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+CaptureWriter::CaptureWriter() :
+    _sink(),
+    _len(CAPTURE_PACKET_HEADER),
+    _seq(0),
+    _started_ms(0),
+    _packets(0),
+    _dropped(0),
+    _edge_head(0),
+    _edge_tail(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+}
+
+void ICACHE_RAM_ATTR CaptureWriter::edge(uint32_t cycles)
+{
+    if (_edge_head - _edge_tail < CAPTURE_PPS_RING)
+    {
+        _edges[_edge_head & (CAPTURE_PPS_RING-1)] = cycles;
+        ++_edge_head;
+    }
+}
+
+/*
+ * Edges that happened before a read must come before its data record.
+ */
+void CaptureWriter::drain()
+{
+    while (_edge_tail != _edge_head)
+    {
+        uint8_t* p = reserve(5);
+        p[0] = CAPTURE_PPS;
+        put32(p+1, _edges[_edge_tail & (CAPTURE_PPS_RING-1)]);
+        ++_edge_tail;
+    }
+}
+
+void CaptureWriter::data(uint32_t cycles, const uint8_t* data, uint8_t len,
+                         const uint8_t* offsets, const uint32_t* stamps, uint8_t count)
+{
+    drain();
+    uint8_t* p = reserve(7 + count * 5 + len);
+    p[0] = CAPTURE_DATA;
+    put32(p+1, cycles);
+    p[5] = len;
+    p[6] = count;
+    p   += 7;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        p[0] = offsets[i];
+        put32(p+1, stamps[i]);
+        p += 5;
+    }
+    memcpy(p, data, len);
+}
+
+void CaptureWriter::process()
+{
+    drain();
+    if (_len > CAPTURE_PACKET_HEADER && hal::millis() - _started_ms >= CAPTURE_FLUSH_MS)
+    {
+        send();
+    }
+}
+
+void CaptureWriter::flush()
+{
+    drain();
+    if (_len > CAPTURE_PACKET_HEADER)
+    {
+        send();
+    }
+}
+
+/*
+ * Room for a 'len' byte record, sending the packet first if it won't fit.
+ */
+uint8_t* CaptureWriter::reserve(size_t len)
+{
+    if (_len + len > CAPTURE_PACKET_SIZE)
+    {
+        send();
+    }
+    if (_len == CAPTURE_PACKET_HEADER)
+    {
+        _started_ms = hal::millis();
+    }
+    uint8_t* p = _packet + _len;
+    _len += len;
+    return p;
+}
+
+void CaptureWriter::send()
+{
+    memcpy(_packet, CAPTURE_MAGIC, 2);
+    _packet[2] = (uint8_t)_seq;
+    _packet[3] = (uint8_t)(_seq >> 8);
+    ++_seq;  // a gap in the sequence is a lost (or dropped) packet
+
+    if (_sink && _sink(_packet, _len))
+    {
+        ++_packets;
+    }
+    else
+    {
+        ++_dropped;
+    }
+    _len = CAPTURE_PACKET_HEADER;
+}
+
+CaptureSerial::CaptureSerial(hal::SerialPort& serial, CaptureWriter& writer) :
+    _serial(serial),
+    _writer(writer),
+    _index(0),
+    _count(0),
+    _next(0)
+{
+}
+
+CaptureSerial::~CaptureSerial()
+{
+}
+
+int CaptureSerial::read()
+{
+    char c;
+    return read(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+/*
+ * Read from the real port and pick up the stamps for the chunk right away
+ * so they can be recorded with it.  GPS then gets them from us.
+ */
+size_t CaptureSerial::read(char* buffer, size_t size)
+{
+    if (size > CAPTURE_MAX_READ)
+    {
+        size = CAPTURE_MAX_READ;
+    }
+
+    uint32_t index = _serial.getReadIndex();
+    size_t   len   = _serial.read(buffer, size);
+    uint32_t now   = hal::cycles();
+
+    _index = index;
+    _count = 0;
+    _next  = 0;
+    for (size_t i = 0; i < len && _count < CAPTURE_MAX_STAMPS; ++i)
+    {
+        uint8_t c = (uint8_t)buffer[i];
+        if ((c == '$' || c == 0xb5) && _serial.getStamp(index + i, &_stamps[_count]))
+        {
+            _offsets[_count++] = (uint8_t)i;
+        }
+    }
+
+    if (len > 0)
+    {
+        _writer.data(now, (const uint8_t*)buffer, (uint8_t)len, _offsets, _stamps, _count);
+    }
+    return len;
+}
+
+bool CaptureSerial::getStamp(uint32_t index, uint32_t* cycles)
+{
+    while (_next < _count)
+    {
+        int32_t diff = (int32_t)(_index + _offsets[_next] - index);
+        if (diff > 0)
+        {
+            return false;
+        }
+        ++_next;
+        if (diff == 0)
+        {
+            *cycles = _stamps[_next-1];
+            return true;
+        }
+    }
+    return false;
+}
+
+CapturePinInterrupt::CapturePinInterrupt(hal::PinInterrupt& pin, CaptureWriter& writer) :
+    _pin(pin),
+    _writer(writer),
+    _handler()
+{
+}
+
+CapturePinInterrupt::~CapturePinInterrupt()
+{
+}
+
+void CapturePinInterrupt::attach(std::function<void()> handler)
+{
+    _handler = handler;
+    _pin.attach(std::bind(&CapturePinInterrupt::edge, this));
+}
+
+void CapturePinInterrupt::detach()
+{
+    _pin.detach();
+    _handler = nullptr;
+}
+
+void ICACHE_RAM_ATTR CapturePinInterrupt::edge()
+{
+    _writer.edge(hal::cycles());
+    _handler();
+}
+
+CaptureReader::CaptureReader(const uint8_t* data, size_t len) :
+    _data(data),
+    _len(len),
+    _offset(CAPTURE_FILE_HEADER),
+    _valid(len >= CAPTURE_FILE_HEADER && memcmp(data, CAPTURE_FILE_MAGIC, CAPTURE_FILE_HEADER) == 0)
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+}
+
+bool CaptureReader::next(CaptureRecord* record)
+{
+    if (!_valid || _offset >= _len)
+    {
+        return false;
+    }
+
+    const uint8_t* p    = _data + _offset;
+    size_t         left = _len - _offset;
+    size_t         size;
+
+    record->type = p[0];
+    switch (p[0])
+    {
+    case CAPTURE_PPS:
+        size = 5;
+        if (left < size)
+        {
+            return false;
+        }
+        record->cycles = get32(p+1);
+        break;
+
+    case CAPTURE_DATA:
+        if (left < 7)
+        {
+            return false;
+        }
+        record->cycles = get32(p+1);
+        record->len    = p[5];
+        record->count  = p[6];
+        size = 7 + record->count * 5 + record->len;
+        if (left < size)
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < record->count; ++i)
+        {
+            record->offsets[i] = p[7 + i*5];
+            record->stamps[i]  = get32(p + 8 + i*5);
+        }
+        record->data = p + 7 + record->count * 5;
+        break;
+
+    case CAPTURE_LOST:
+        size = 3;
+        if (left < size)
+        {
+            return false;
+        }
+        record->lost = (uint16_t)(p[1] | (p[2] << 8));
+        break;
+
+    default:
+        _valid = false;
+        return false;
+    }
+
+    _offset += size;
+    return true;
+}
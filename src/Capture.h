@@ -0,0 +1,182 @@
+/*
+ * Capture.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 8, 2018
+ *      Author: chris.l
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include "hal/HAL.h"
+#include "hal/SerialPort.h"
+#include "hal/PinInterrupt.h"
+
+//
+// Capture of the raw GPS input: every byte GPS reads from the UART, the
+// arrival time of each '$'/0xb5 and the time of each PPS edge, all in
+// CPU cycles.  Records are little endian:
+//
+//   'P' cycles:4                                         PPS edge
+//   'D' cycles:4 len:1 count:1 {offset:1 cycles:4}*count bytes:len
+//                                                        bytes read at 'cycles',
+//                                                        'count' of them stamped
+//   'L' lost:2                                           packets lost in transit
+//
+// On the device the records go out in UDP packets (CAPTURE_MAGIC, a 16 bit
+// sequence number, then whole records) to the syslog host, where the host
+// 'record' command writes them to a file after CAPTURE_FILE_MAGIC.  The
+// host 'replay' command feeds a file back through GPS.
+//
+#define CAPTURE_PORT          5123   // UDP port on the syslog host
+#define CAPTURE_MAGIC         "GC"
+#define CAPTURE_PACKET_HEADER 4      // magic and sequence number
+#define CAPTURE_PACKET_SIZE   512
+#define CAPTURE_FILE_MAGIC    "GPSC\x01\0\0\0"  // with format version
+#define CAPTURE_FILE_HEADER   8
+#define CAPTURE_PPS_RING      8      // edges latched between reads, must be a power of 2
+#define CAPTURE_MAX_STAMPS    8      // stamps kept per data record
+#define CAPTURE_MAX_READ      128    // bytes per data record
+#define CAPTURE_FLUSH_MS      1000   // send a partial packet after this long
+
+#define CAPTURE_PPS           'P'
+#define CAPTURE_DATA          'D'
+#define CAPTURE_LOST          'L'
+
+class CaptureWriter
+{
+public:
+    typedef std::function<bool(const uint8_t* packet, size_t len)> Sink;
+
+    CaptureWriter();
+    virtual ~CaptureWriter();
+
+    void     setSink(Sink sink) { _sink = sink; }
+    void     edge(uint32_t cycles);  // interrupt context
+    void     data(uint32_t cycles, const uint8_t* data, uint8_t len,
+                  const uint8_t* offsets, const uint32_t* stamps, uint8_t count);
+    void     process();
+    void     flush();                // send what there is now
+
+    uint32_t getPackets() { return _packets; }
+    uint32_t getDropped() { return _dropped; }  // packets we had nowhere to send
+
+private:
+    Sink              _sink;
+    uint8_t           _packet[CAPTURE_PACKET_SIZE];
+    size_t            _len;
+    uint16_t          _seq;
+    uint32_t          _started_ms;   // first record in _packet
+    uint32_t          _packets;
+    uint32_t          _dropped;
+    volatile uint32_t _edge_head;
+    volatile uint32_t _edge_tail;
+    uint32_t          _edges[CAPTURE_PPS_RING];
+
+    void     drain();
+    uint8_t* reserve(size_t len);
+    void     send();
+};
+
+//
+// SerialPort that records what is read from the real one.
+//
+class CaptureSerial : public hal::SerialPort
+{
+public:
+    CaptureSerial(hal::SerialPort& serial, CaptureWriter& writer);
+    virtual ~CaptureSerial();
+
+    int      available() override { return _serial.available(); }
+    int      read() override;
+    size_t   read(char* buffer, size_t size) override;
+    size_t   write(const uint8_t* data, size_t len) override { return _serial.write(data, len); }
+    void     flush() override                     { _serial.flush(); }
+    void     setBaud(uint32_t baud) override      { _serial.setBaud(baud); }
+    uint32_t getBaud() override                   { return _serial.getBaud(); }
+
+    uint32_t getReadIndex() override      { return _serial.getReadIndex(); }
+    bool     getStamp(uint32_t index, uint32_t* cycles) override;
+
+    uint32_t getOverflows() override      { return _serial.getOverflows(); }
+    uint32_t getFIFOOverflows() override  { return _serial.getFIFOOverflows(); }
+    uint32_t getStampOverflows() override { return _serial.getStampOverflows(); }
+
+private:
+    hal::SerialPort& _serial;
+    CaptureWriter&   _writer;
+    uint32_t         _index;   // stream index of _stamps[0]
+    uint8_t          _count;
+    uint8_t          _next;    // first stamp not yet handed out
+    uint8_t          _offsets[CAPTURE_MAX_STAMPS];
+    uint32_t         _stamps[CAPTURE_MAX_STAMPS];
+};
+
+//
+// PinInterrupt that latches the edge time for the capture before calling
+// the real handler.
+//
+class CapturePinInterrupt : public hal::PinInterrupt
+{
+public:
+    CapturePinInterrupt(hal::PinInterrupt& pin, CaptureWriter& writer);
+    virtual ~CapturePinInterrupt();
+
+    void attach(std::function<void()> handler) override;
+    void detach() override;
+
+private:
+    hal::PinInterrupt&    _pin;
+    CaptureWriter&        _writer;
+    std::function<void()> _handler;
+
+    void edge();
+};
+
+//
+// Walks the records of a capture file (after the file header).
+//
+typedef struct capture_record
+{
+    uint8_t        type;
+    uint32_t       cycles;
+    uint8_t        len;
+    const uint8_t* data;
+    uint8_t        count;
+    uint8_t        offsets[255];
+    uint32_t       stamps[255];
+    uint16_t       lost;
+} CaptureRecord;
+
+class CaptureReader
+{
+public:
+    CaptureReader(const uint8_t* data, size_t len);
+    virtual ~CaptureReader();
+
+    bool   isValid() { return _valid; }
+    bool   next(CaptureRecord* record);   // false at the end or on a bad record
+    size_t getOffset() { return _offset; }
+
+private:
+    const uint8_t* _data;
+    size_t         _len;
+    size_t         _offset;
+    bool           _valid;
+};
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,249 @@
+/*
+ * ClientTable.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 12, 2018
+ *      Author: chris.l
+ */
+
+#include <string.h>
+#include "ClientTable.h"
+#include "Log.h"
+
+#if (CLIENT_TABLE_PROBES > CLIENT_TABLE_SIZE)
+#error "CLIENT_TABLE_PROBES must not be larger than CLIENT_TABLE_SIZE"
+#endif
+#if (CLIENT_TABLE_SIZE > CLIENT_NONE)
+#error "CLIENT_TABLE_SIZE must fit the uint16_t LRU links"
+#endif
+
+ClientTable::ClientTable() :
+    _entries(),
+    _newest(CLIENT_NONE),
+    _count(0),
+    _evictions(0),
+    _kod_second(0),
+    _kod_budget(CLIENT_KOD_PER_SEC)
+{
+}
+
+ClientTable::~ClientTable()
+{
+}
+
+void ClientTable::reset()
+{
+    memset(_entries, 0, sizeof(_entries));
+    _newest     = CLIENT_NONE;
+    _count      = 0;
+    _evictions  = 0;
+    _kod_second = 0;
+    _kod_budget = CLIENT_KOD_PER_SEC;
+}
+
+void ClientTable::unlink(ClientEntry* entry)
+{
+    if (entry->newer == CLIENT_NONE)
+    {
+        _newest = entry->older;
+    }
+    else
+    {
+        _entries[entry->newer].older = entry->older;
+    }
+
+    if (entry->older != CLIENT_NONE)
+    {
+        _entries[entry->older].newer = entry->newer;
+    }
+}
+
+void ClientTable::push(ClientEntry* entry)
+{
+    uint16_t slot = (uint16_t)(entry - _entries);
+    entry->newer = CLIENT_NONE;
+    entry->older = _newest;
+    if (_newest != CLIENT_NONE)
+    {
+        _entries[_newest].newer = slot;
+    }
+    _newest = slot;
+}
+
+/*
+ * Find the client's slot, or give it one: an unused slot if there is one
+ * in its probe window, otherwise the one we heard from least recently.
+ * Either way it ends up at the front of the LRU list.
+ */
+ClientEntry* ClientTable::find(uint32_t addr, uint32_t now_ms)
+{
+    uint32_t     hash   = (addr * 2654435761u) >> (32 - CLIENT_TABLE_BITS);
+    ClientEntry* victim = nullptr;
+    uint32_t     oldest = 0;
+
+    for (uint32_t i = 0; i < CLIENT_TABLE_PROBES; ++i)
+    {
+        ClientEntry* entry = &_entries[(hash + i) & (CLIENT_TABLE_SIZE-1)];
+        if (entry->addr == addr)
+        {
+            if (_newest != (uint16_t)(entry - _entries))
+            {
+                unlink(entry);
+                push(entry);
+            }
+            return entry;
+        }
+
+        uint32_t age = entry->addr == 0 ? UINT32_MAX : now_ms - entry->last_ms;
+        if (victim == nullptr || age > oldest)
+        {
+            victim = entry;
+            oldest = age;
+        }
+    }
+
+    if (victim->addr != 0)
+    {
+        unlink(victim);
+        ++_evictions;
+    }
+    else
+    {
+        ++_count;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->addr     = addr;
+    victim->first_ms = now_ms;
+    victim->due_ms   = now_ms;
+    victim->kod_ms   = now_ms - CLIENT_KOD_INTERVAL_MS;
+    push(victim);
+    return victim;
+}
+
+/*
+ * Note a request from addr, the entry is the client's from now on.  addr
+ * must not be 0, that marks an unused slot.
+ */
+ClientEntry& ClientTable::seen(uint32_t addr, uint8_t mode, uint8_t version, uint32_t now_ms)
+{
+    ClientEntry* entry = find(addr, now_ms);
+    ++entry->requests;
+    entry->last_ms = now_ms;
+    entry->mode    = mode;
+    entry->version = version;
+    return *entry;
+}
+
+/*
+ * Decide how to treat the request just seen.  Requests over the limit do
+ * not use up tokens so a client that backs off when told to is answered
+ * again as soon as its bucket allows.
+ */
+ClientVerdict ClientTable::limit(ClientEntry& entry, uint32_t now_ms)
+{
+    int32_t ahead = (int32_t)(entry.due_ms - now_ms);
+    if (ahead < 0)
+    {
+        entry.due_ms = now_ms;
+        ahead        = 0;
+    }
+
+    if (ahead <= (CLIENT_BURST - 1) * CLIENT_INTERVAL_MS)
+    {
+        entry.due_ms += CLIENT_INTERVAL_MS;
+        return CLIENT_ANSWER;
+    }
+
+    uint32_t second = now_ms / 1000;
+    if (second != _kod_second)
+    {
+        _kod_second = second;
+        _kod_budget = CLIENT_KOD_PER_SEC;
+    }
+
+    if (_kod_budget > 0 && now_ms - entry.kod_ms >= CLIENT_KOD_INTERVAL_MS)
+    {
+        --_kod_budget;
+        entry.kod_ms = now_ms;
+        ++entry.kods;
+        return CLIENT_KOD;
+    }
+
+    ++entry.drops;
+    return CLIENT_DROP;
+}
+
+uint32_t ClientTable::getInterval(const ClientEntry& entry)
+{
+    return entry.requests > 1 ? (entry.last_ms - entry.first_ms) / (entry.requests - 1) : 0;
+}
+
+/*
+ * The busiest clients (most requests) and the totals, selecting them is
+ * O(CLIENT_TABLE_SIZE * CLIENT_LOG_MAX) with nothing to sort.
+ */
+void ClientTable::logClients(const char* tag)
+{
+    uint32_t limited = 0;
+    for (const ClientEntry* entry = getNewest(); entry != nullptr; entry = getOlder(*entry))
+    {
+        if (entry->kods != 0 || entry->drops != 0)
+        {
+            ++limited;
+        }
+    }
+    dlog.info(tag, F("clients: %lu/%u limited:%lu evictions:%lu"), _count, CLIENT_TABLE_SIZE, limited, _evictions);
+
+    uint32_t bound = UINT32_MAX;    // requests of the last one logged
+    const ClientEntry* shown = nullptr;
+    for (int n = 0; n < CLIENT_LOG_MAX; ++n)
+    {
+        //
+        // the next busiest: fewer requests than the last one shown or as
+        // many but further down the list
+        //
+        const ClientEntry* busiest = nullptr;
+        bool               after   = shown == nullptr;
+        for (const ClientEntry* entry = getNewest(); entry != nullptr; entry = getOlder(*entry))
+        {
+            if (entry == shown)
+            {
+                after = true;
+                continue;
+            }
+            if (entry->requests > bound || (entry->requests == bound && !after))
+            {
+                continue;
+            }
+            if (busiest == nullptr || entry->requests > busiest->requests)
+            {
+                busiest = entry;
+            }
+        }
+        if (busiest == nullptr)
+        {
+            break;
+        }
+
+        const uint8_t* ip = (const uint8_t*)&busiest->addr;
+        dlog.info(tag, F("client %u.%u.%u.%u: requests:%lu over:%lus interval:%lums mode:%u version:%u kods:%lu drops:%lu"),
+                ip[0], ip[1], ip[2], ip[3], busiest->requests, (busiest->last_ms - busiest->first_ms) / 1000,
+                getInterval(*busiest), busiest->mode, busiest->version, busiest->kods, busiest->drops);
+        bound = busiest->requests;
+        shown = busiest;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * ClientTable.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 12, 2018
+ *      Author: chris.l
+ */
+
+#ifndef CLIENTTABLE_H_
+#define CLIENTTABLE_H_
+
+#include <stdint.h>
+
+#define CLIENT_TABLE_BITS       8     // the table holds 1 << this many clients (40 bytes each)
+#define CLIENT_TABLE_SIZE       (1 << CLIENT_TABLE_BITS)
+#define CLIENT_TABLE_PROBES     8     // slots searched for a client, a new one replaces the oldest of them
+#define CLIENT_NONE             0xffff // end of the LRU list
+#define CLIENT_BURST            8     // requests a client may send back to back
+#define CLIENT_INTERVAL_MS      2000  // after a burst, one request per this long
+#define CLIENT_KOD_INTERVAL_MS  8000  // at most one RATE KoD per client this often, otherwise drop
+#define CLIENT_KOD_PER_SEC      10    // at most this many RATE KoDs a second in total, otherwise drop
+#define CLIENT_LOG_MAX          8     // logClients() shows the busiest this many
+
+typedef enum
+{
+    CLIENT_ANSWER,   // within its rate, answer normally
+    CLIENT_KOD,      // over its rate, send a RATE Kiss-o'-Death
+    CLIENT_DROP      // over its rate and we already told it (or are too busy to), stay silent
+} ClientVerdict;
+
+typedef struct client_entry
+{
+    uint32_t addr;      // IPv4 address in network byte order, 0 for an unused slot
+    uint32_t first_ms;  // millis() when this client took the slot
+    uint32_t last_ms;   // millis() of its latest request
+    uint32_t due_ms;    // token bucket: millis() at which the bucket is full again
+    uint32_t kod_ms;    // millis() of the last KoD we sent it
+    uint32_t requests;
+    uint32_t kods;
+    uint32_t drops;
+    uint16_t newer;     // LRU list: slot of the client heard from next after this one
+    uint16_t older;     // and just before it
+    uint8_t  mode;      // of its latest request
+    uint8_t  version;
+} ClientEntry;
+
+//
+// The most recently seen clients (an MRU list like ntpd's) in a fixed size
+// open addressed hash table.  No allocation after construction: a new
+// client replaces the least recently heard from of the CLIENT_TABLE_PROBES
+// slots its address hashes to.  The slots are also linked newest to
+// oldest, moving a client to the front is O(1) and lists come out in
+// order without sorting.
+//
+// The rate limit is a token bucket kept as the time it will be full
+// again: each answered request pushes that CLIENT_INTERVAL_MS later and a
+// request that would push it more than a burst ahead of now is over.
+//
+class ClientTable
+{
+public:
+    ClientTable();
+    virtual ~ClientTable();
+
+    void          reset();
+    ClientEntry&  seen(uint32_t addr, uint8_t mode, uint8_t version, uint32_t now_ms);
+    ClientVerdict limit(ClientEntry& entry, uint32_t now_ms);
+    void          logClients(const char* tag);
+
+    const ClientEntry* getNewest()                          { return at(_newest); }
+    const ClientEntry* getOlder(const ClientEntry& entry)   { return at(entry.older); }
+    uint32_t      getCount()                                { return _count; }
+    uint32_t      getEvictions()                            { return _evictions; }
+    static uint32_t getInterval(const ClientEntry& entry);  // average ms between its requests
+
+private:
+    ClientEntry _entries[CLIENT_TABLE_SIZE];
+    uint16_t    _newest;         // head of the LRU list
+    uint32_t    _count;          // slots in use
+    uint32_t    _evictions;      // clients pushed out by newer ones
+    uint32_t    _kod_second;     // now_ms / 1000 that _kod_budget applies to
+    uint32_t    _kod_budget;     // KoDs we may still send in that second
+
+    ClientEntry* at(uint16_t slot) { return slot == CLIENT_NONE ? nullptr : &_entries[slot]; }
+    ClientEntry* find(uint32_t addr, uint32_t now_ms);
+    void         unlink(ClientEntry* entry);
+    void         push(ClientEntry* entry);
+};
+
+#endif /* CLIENTTABLE_H_ */
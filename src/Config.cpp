@@ -6,15 +6,15 @@
  */
 
 #include "Config.h"
-#include "FS.h"
 #include "Log.h"
 #include "ArduinoJson.h"
 
 static const char* TAG = "Config";
 static const char* CONFIG_FILE = "/Config.json";
+static const char* DRIFT_FILE  = "/drift.json";
 
 
-Config::Config() : _syslog_host(), _syslog_port(0)
+Config::Config(hal::FileSystem& fs) : _fs(fs), _syslog_host(), _syslog_port(0), _holdover_limit(HOLDOVER_LIMIT), _wifi_reset_timeout(WIFI_RESET_TIMEOUT), _access(), _access_count(0)
 {
 }
 
@@ -26,16 +26,16 @@ bool Config::begin()
 {
     dlog.info(TAG, "begin: Mounting SPIFFS");
 
-    if (!SPIFFS.begin())
+    if (!_fs.begin())
     {
         dlog.warning(TAG, "begin: Formatting SPIFFS!!!!!");
-        if (SPIFFS.format())
+        if (_fs.format())
         {
             dlog.error(TAG, "begin: SPIFFS format failed!");
             return false;
         }
         dlog.info(TAG, "begin: mounting SPIFFS after format!");
-        if (!SPIFFS.begin())
+        if (!_fs.begin())
         {
             dlog.error(TAG, "begin: SPIFFS mount failed!!!!");
             return false;
@@ -43,12 +43,10 @@ bool Config::begin()
     }
 
     dlog.info(TAG, "begin scanning SPIFFS files");
-    Dir dir = SPIFFS.openDir("");
-    while (dir.next())
+    _fs.list([](const char* name, size_t size)
     {
-        File f = dir.openFile("r");
-        dlog.info(TAG, "begin: file: '%s' size %d", dir.fileName().c_str(), f.size());
-    }
+        dlog.info(TAG, "begin: file: '%s' size %d", name, (int)size);
+    });
     return true;
 }
 
@@ -56,24 +54,25 @@ bool Config::load()
 {
     dlog.info(TAG, "load: file: '%s'", CONFIG_FILE);
 
-    if (!SPIFFS.exists(CONFIG_FILE))
+    if (!_fs.exists(CONFIG_FILE))
     {
         dlog.warning(TAG, "load: config file does not exist!");
         return false;
     }
 
-    File f = SPIFFS.open(CONFIG_FILE, "r");
-    if (!f)
+    char json[CONFIG_FILE_SIZE];
+    int  len = _fs.read(CONFIG_FILE, json, sizeof(json)-1);
+    if (len < 0)
     {
         dlog.error(TAG, "load: failed to open config file!");
         return false;
     }
+    json[len] = '\0';
 
     StaticJsonBuffer<512> buffer;
 
     dlog.debug(TAG, "load: parsing file contents");
-    JsonObject& root = buffer.parseObject(f);
-    f.close();
+    JsonObject& root = buffer.parseObject(json);
 
     if (!root.success())
     {
@@ -83,6 +82,28 @@ bool Config::load()
 
     strlcpy(_syslog_host, root["syslogHost"]|"", sizeof(_syslog_host));
     _syslog_port = root["syslogPort"] | 0;
+    _holdover_limit = root["holdoverLimit"] | HOLDOVER_LIMIT;
+    _wifi_reset_timeout = root["wifiResetTimeout"] | WIFI_RESET_TIMEOUT;
+
+    //
+    // "access": ["192.168.1.0/24 serve", "0.0.0.0/0 ignore"], bad rules
+    // are skipped (and logged)
+    //
+    _access_count = 0;
+    JsonArray& access = root["access"];
+    for (JsonVariant& item : access)
+    {
+        const char* text = item.as<const char*>();
+        if (_access_count >= ACCESS_RULES_MAX)
+        {
+            dlog.error(TAG, "load: more than %u access rules, ignoring the rest!", ACCESS_RULES_MAX);
+            break;
+        }
+        if (text != nullptr && AccessList::parse(text, &_access[_access_count]))
+        {
+            ++_access_count;
+        }
+    }
 
     dlog.info(TAG, "load: config loaded!");
     return true;
@@ -92,20 +113,91 @@ void Config::save()
 {
     dlog.info(TAG, "save: file: '%s'", CONFIG_FILE);
 
-    File f = SPIFFS.open(CONFIG_FILE, "w");
-
     StaticJsonBuffer<512> buffer;
     JsonObject& root = buffer.createObject();
 
     root["syslogHost"] = _syslog_host;
     root["syslogPort"] = _syslog_port;
+    root["holdoverLimit"] = _holdover_limit;
+    root["wifiResetTimeout"] = _wifi_reset_timeout;
 
-    root.printTo(f);
-    f.close();
+    char access_text[ACCESS_RULES_MAX][ACCESS_TEXT_SIZE];
+    if (_access_count > 0)
+    {
+        JsonArray& access = root.createNestedArray("access");
+        for (unsigned i = 0; i < _access_count; ++i)
+        {
+            AccessList::format(_access[i], access_text[i], sizeof(access_text[i]));
+            access.add((const char*)access_text[i]);
+        }
+    }
+
+    char   json[CONFIG_FILE_SIZE];
+    size_t len = root.printTo(json, sizeof(json));
+    if (!_fs.write(CONFIG_FILE, json, len))
+    {
+        dlog.error(TAG, "save: failed to write config file!");
+        return;
+    }
 
     dlog.info(TAG, "save: config saved");
 }
 
+/*
+ * The oscillator frequency error (ppb) and when (epoch seconds) it was
+ * saved, kept apart from the config so the config is never rewritten.
+ */
+bool Config::loadDrift(int32_t* ppb, uint32_t* saved)
+{
+    if (!_fs.exists(DRIFT_FILE))
+    {
+        dlog.info(TAG, "loadDrift: no drift file");
+        return false;
+    }
+
+    char json[DRIFT_FILE_SIZE];
+    int  len = _fs.read(DRIFT_FILE, json, sizeof(json)-1);
+    if (len < 0)
+    {
+        dlog.error(TAG, "loadDrift: failed to open drift file!");
+        return false;
+    }
+    json[len] = '\0';
+
+    StaticJsonBuffer<128> buffer;
+    JsonObject& root = buffer.parseObject(json);
+
+    if (!root.success() || !root.containsKey("ppb") || !root.containsKey("saved"))
+    {
+        dlog.error(TAG, "loadDrift: fails to parse file!");
+        return false;
+    }
+
+    *ppb   = root["ppb"] | 0;
+    *saved = root["saved"] | 0;
+    dlog.info(TAG, "loadDrift: ppb:%ld saved:%lu", (long)*ppb, (unsigned long)*saved);
+    return true;
+}
+
+bool Config::saveDrift(int32_t ppb, uint32_t saved)
+{
+    StaticJsonBuffer<128> buffer;
+    JsonObject& root = buffer.createObject();
+    root["ppb"]   = ppb;
+    root["saved"] = saved;
+
+    char   json[DRIFT_FILE_SIZE];
+    size_t len = root.printTo(json, sizeof(json));
+    if (!_fs.write(DRIFT_FILE, json, len))
+    {
+        dlog.error(TAG, "saveDrift: failed to write drift file!");
+        return false;
+    }
+
+    dlog.info(TAG, "saveDrift: ppb:%ld saved:%lu", (long)ppb, (unsigned long)saved);
+    return true;
+}
+
 const char* Config::getSyslogHost()
 {
     return _syslog_host;
@@ -125,3 +217,23 @@ void Config::setSyslogPort(uint16_t port)
 {
     _syslog_port = port;
 }
+
+uint32_t Config::getHoldoverLimit()
+{
+    return _holdover_limit;
+}
+
+void Config::setHoldoverLimit(uint32_t seconds)
+{
+    _holdover_limit = seconds;
+}
+
+uint32_t Config::getWiFiResetTimeout()
+{
+    return _wifi_reset_timeout;
+}
+
+void Config::setWiFiResetTimeout(uint32_t seconds)
+{
+    _wifi_reset_timeout = seconds;
+}
@@ -8,14 +8,19 @@
 #ifndef CONFIG_H_
 #define CONFIG_H_
 
-#include "Arduino.h"
+#include "hal/HAL.h"
+#include "hal/FileSystem.h"
+#include "AccessList.h"
 
-class ConfigImpl;
+#define HOLDOVER_LIMIT     3600 // default seconds of holdover before we report not synchronized
+#define WIFI_RESET_TIMEOUT 900 // default seconds without an IP before we give up and reset
+#define CONFIG_FILE_SIZE   1024 // largest config file we read (16 access rules need about 500 bytes)
+#define DRIFT_FILE_SIZE    128 // largest drift file we read
 
 class Config
 {
 public:
-    Config();
+    Config(hal::FileSystem& fs);
     virtual ~Config();
 
     bool        begin();
@@ -27,10 +32,24 @@ public:
     void        setSyslogHost(const char* host);
     uint16_t    getSyslogPort();
     void        setSyslogPort(uint16_t port);
+    uint32_t    getHoldoverLimit();
+    void        setHoldoverLimit(uint32_t seconds);
+    uint32_t    getWiFiResetTimeout();
+    void        setWiFiResetTimeout(uint32_t seconds);
+    const AccessRule* getAccessRules()  { return _access; }
+    unsigned    getAccessCount()        { return _access_count; }
+
+    bool        loadDrift(int32_t* ppb, uint32_t* saved);
+    bool        saveDrift(int32_t ppb, uint32_t saved);
 
 private:
+    hal::FileSystem& _fs;
     char     _syslog_host[64];
     uint16_t _syslog_port;
+    uint32_t _holdover_limit;
+    uint32_t _wifi_reset_timeout;
+    AccessRule _access[ACCESS_RULES_MAX];
+    unsigned _access_count;
 };
 
 #endif /* CONFIG_H_ */
@@ -43,7 +43,9 @@ void Display::end()
 
 void Display::process()
 {
-    time_t secs = _gps.getSeconds();;
+    PPSSnapshot snap;
+    _gps.getSnapshot(&snap);
+    time_t secs = snap.seconds;
     struct tm tm;
     gmtime_r(&secs, &tm);
 
@@ -89,7 +91,7 @@ void Display::process()
     print(0, 20, "Reqs: %d", _ntp.getReqCount());
     print(0, 30, "Rsps: %d", _ntp.getRspCount());
 
-    if (_gps.isValid())
+    if (snap.valid)
     {
         uint32_t seconds  = secs - _gps.getValidSince();
         uint32_t days     = seconds / 86400;
@@ -101,6 +103,11 @@ void Display::process()
         align(TEXT_ALIGN_RIGHT);
         print(127, 40, "%dd %02dh %02dm %02ds", days, hours, minutes, seconds);
     }
+    else if (snap.holdover)
+    {
+        align(TEXT_ALIGN_CENTER);
+        print(64, 40, "HOLDOVER %ds", _gps.getHoldoverSeconds());
+    }
     else
     {
         if (_gps.isGPSValid())
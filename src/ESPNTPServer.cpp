@@ -28,37 +28,95 @@
 #include "DLogSyslogWriter.h"
 
 #include "GPS.h"
+#include "GPSSerial.h"
 #include "NTP.h"
 #include "Display.h"
 #include "Config.h"
+#include "Benchmark.h"
+#include "hal/esp8266/ESPFileSystem.h"
+#include "hal/esp8266/ESPPinInterrupt.h"
+#include "hal/esp8266/ESPTimer.h"
+#if defined(NTP_RAW_UDP)
+#include "hal/esp8266/ESPRawUDPEndpoint.h"
+#else
+#include "hal/esp8266/ESPUDPEndpoint.h"
+#endif
+#if defined(NTP_LINK_STAMP)
+#include "hal/esp8266/ESPLinkStamp.h"
+#endif
+#if defined(GPS_CAPTURE)
+#include "Capture.h"
+#include "ESPAsyncUDP.h"
+#endif
 
 DLog& dlog = DLog::getLog();
-GPS gps(Serial, SYNC_PIN);
-NTP ntp(gps);
+hal::ESPFileSystem file_system;   // not "fs", the core (FS.h, ESP8266WebServer.h) has a namespace fs
+Config config(file_system);
+GPSSerial gps_serial;
+hal::ESPPinInterrupt pps_pin(SYNC_PIN);
+hal::ESPTimer pps_timer;
+#if defined(GPS_CAPTURE)
+CaptureWriter capture;
+CaptureSerial capture_serial(gps_serial, capture);
+CapturePinInterrupt capture_pin(pps_pin, capture);
+AsyncUDP capture_udp;
+GPS gps(capture_serial, capture_pin, pps_timer, config);
+#else
+GPS gps(gps_serial, pps_pin, pps_timer, config);
+#endif
+#if defined(NTP_RAW_UDP)
+hal::ESPRawUDPEndpoint ntp_udp;
+#else
+hal::ESPUDPEndpoint ntp_udp;
+#endif
+NTP ntp(gps, ntp_udp);
 Display display(gps, ntp, SDA_PIN, SCL_PIN);
-Config config;
 
 char devicename[32];
 
 const char* SETUP_TAG = "setup";
 const char* LOOP_TAG  = "loop";
+const char* BOOT_TAG  = "boot";
+
+//
+// setup() only does what is quick and local, the rest of the boot is
+// driven from loop() so GPS lock overlaps WiFi association and NTP is
+// serving as soon as there is an IP address.
+//
+typedef enum
+{
+    BOOT_WIFI,     // waiting for an IP address
+    BOOT_NTP,      // binding the NTP port
+    BOOT_SERVICES, // syslog and OTA
+    BOOT_RUNNING
+} BootState;
+
+static const char* const boot_state_names[] = {"WIFI", "NTP", "SERVICES", "RUNNING"};
+
+static BootState  boot_state;
+static uint32_t   boot_phase_ms;    // millis() when the phase started
+static uint32_t   boot_retry_ms;
+#if !defined(USE_NO_WIFI)
+static WiFiSetup* wifi;
+#endif
 
 void logTimeFirst(DLogBuffer& buffer, DLogLevel level)
 {
     (void)level; // not used
-    struct timeval tv;
+    Timestamp ts;
     struct tm tm;
-    gps.getTime(&tv);
-    gmtime_r(&tv.tv_sec, &tm);
+    gps.getTime(&ts);
+    time_t seconds = toEPOCH(TS_SECONDS(ts));
+    gmtime_r(&seconds, &tm);
 
-    buffer.printf(F("%04d/%02d/%02d %02d:%02d:%02d.%06ld "),
+    buffer.printf(F("%04d/%02d/%02d %02d:%02d:%02d.%06lu "),
             tm.tm_year+1900,
             tm.tm_mon+1,
             tm.tm_mday,
             tm.tm_hour,
             tm.tm_min,
             tm.tm_sec,
-            tv.tv_usec);
+            (unsigned long)frac2us(TS_FRACTION(ts)));
 }
 
 void processOTA(const char* ota_url, const char* ota_fp)
@@ -133,6 +191,145 @@ void processOTA(const char* ota_url, const char* ota_fp)
 	}
 }
 
+#if defined(NTP_RAW_UDP)
+/*
+ * Whether replies went out in the request's own pbuf, with the heap
+ * numbers in the loop line this is what the raw endpoint saves.
+ */
+static void logRawUDP()
+{
+    dlog.info("NTP", F("raw udp replies: in place:%lu chained:%lu failed:%lu"),
+            hal::ESPRawUDPEndpoint::getInPlace(), hal::ESPRawUDPEndpoint::getChained(),
+            hal::ESPRawUDPEndpoint::getFailed());
+}
+#endif
+
+#if defined(NTP_LINK_STAMP)
+/*
+ * How much earlier the link layer stamps were than the transport's own,
+ * the time spent getting a request up through lwIP.
+ */
+static void logLinkStamps()
+{
+    if (hal::ESPLinkStamp::getHits() == 0 && hal::ESPLinkStamp::getMisses() > 0)
+    {
+        dlog.warning("NTP", F("link stamps: none of %lu requests matched a frame (%lu frames stamped, %lu netifs unhooked), %s"),
+                hal::ESPLinkStamp::getMisses(), hal::ESPLinkStamp::getFrames(), hal::ESPLinkStamp::getUnhooked(),
+                hal::ESPLinkStamp::getFrames() == 0 ? "frames do not come through netif->input" : "frames are copied before UDP");
+    }
+    dlog.info("NTP", F("link stamps: frames:%lu hits:%lu misses:%lu saved (us, log2 bins <1..<256 >=256): %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu"),
+            hal::ESPLinkStamp::getFrames(), hal::ESPLinkStamp::getHits(), hal::ESPLinkStamp::getMisses(),
+            hal::ESPLinkStamp::getBin(0), hal::ESPLinkStamp::getBin(1), hal::ESPLinkStamp::getBin(2),
+            hal::ESPLinkStamp::getBin(3), hal::ESPLinkStamp::getBin(4), hal::ESPLinkStamp::getBin(5),
+            hal::ESPLinkStamp::getBin(6), hal::ESPLinkStamp::getBin(7), hal::ESPLinkStamp::getBin(8),
+            hal::ESPLinkStamp::getBin(9));
+}
+#endif
+
+static void bootPhase(BootState state)
+{
+    boot_state    = state;
+    boot_phase_ms = millis();
+    dlog.info(BOOT_TAG, F("phase %s at %lu ms"), boot_state_names[state], millis());
+}
+
+static void boot()
+{
+    switch (boot_state)
+    {
+    case BOOT_WIFI:
+#if !defined(USE_NO_WIFI)
+        if (!wifi->process())
+        {
+            //
+            // the outage timer only runs once we are RUNNING, give up on
+            // the saved network the same way: ask for another, then reset
+            //
+            if (millis() - boot_phase_ms > config.getWiFiResetTimeout() * 1000)
+            {
+                dlog.error(BOOT_TAG, F("no ip address after %lu ms!"), millis() - boot_phase_ms);
+                if (!wifi->portal())
+                {
+                    dlog.error(BOOT_TAG, F("config portal timed out!  Resetting!"));
+                    ESP.reset();
+                    delay(10000);
+                }
+                boot_phase_ms = millis();
+            }
+            break;
+        }
+        dlog.info(BOOT_TAG, F("ip address: %s"), WiFi.localIP().toString().c_str());
+#endif
+        bootPhase(BOOT_NTP);
+        break;
+
+    case BOOT_NTP:
+        if (millis() - boot_retry_ms < NTP_LISTEN_RETRY_MS)
+        {
+            break;
+        }
+        boot_retry_ms = millis();
+        if (ntp.listen())
+        {
+            bootPhase(BOOT_SERVICES);
+        }
+        break;
+
+    case BOOT_SERVICES:
+    {
+#if !defined(USE_NO_WIFI)
+        const char* syslog_host = config.getSyslogHost();
+        uint16_t    syslog_port = config.getSyslogPort();
+        if (syslog_host != nullptr && strlen(syslog_host) > 0 && syslog_port != 0)
+        {
+            dlog.info(BOOT_TAG, "enabling syslog: '%s:%u'", syslog_host, syslog_port);
+            dlog.begin(new DLogSyslogWriter(syslog_host, syslog_port, devicename, ESPNTP_SERVER_VERSION));
+        }
+
+#if defined(GPS_CAPTURE)
+        //
+        // the capture goes to the syslog host, run "espntp record" there
+        //
+        IPAddress capture_ip;
+        if (syslog_host != nullptr && strlen(syslog_host) > 0 && WiFi.hostByName(syslog_host, capture_ip))
+        {
+            dlog.info(BOOT_TAG, "sending GPS capture to '%s:%u'", syslog_host, CAPTURE_PORT);
+            capture.setSink([capture_ip](const uint8_t* packet, size_t len)
+            {
+                return capture_udp.writeTo(packet, len, capture_ip, CAPTURE_PORT) == len;
+            });
+        }
+#endif
+
+        dlog.info(BOOT_TAG, "ESP::FullVersion: %s", ESP.getFullVersion().c_str());
+
+        //
+        // OTA still blocks, but NTP is already answering from the network stack
+        //
+        const char* url = wifi->getOTAURL();
+        const char* fp  = wifi->getOTAFP();
+        if (fp == nullptr)
+        {
+            fp = "";
+        }
+
+        if (url != nullptr)
+        {
+            processOTA(url, fp);
+        }
+
+        dlog.info(BOOT_TAG, F("WiFi mode: %d"), WiFi.getMode());
+        dlog.info(BOOT_TAG, F("wifi sleep mode: %d"), WiFi.getSleepMode());
+#endif
+        bootPhase(BOOT_RUNNING);
+        break;
+    }
+
+    case BOOT_RUNNING:
+        break;
+    }
+}
+
 void setup()
 {
     //delay(5000); // delay for IDE to re-open serial
@@ -151,13 +348,18 @@ void setup()
     snprintf(devicename, sizeof(devicename), "ESPNTP:%08x", ESP.getChipId());
     dlog.info(SETUP_TAG, "Device name: %s", devicename);
 
+#if defined(BENCHMARK)
+    benchmark();
+#endif
+
     dlog.info(SETUP_TAG, F("initializing display"));
     display.begin();
 
 
     dlog.info(SETUP_TAG, F("initializing serial for GPS"));
-    Serial.begin(9600);
-    Serial.swap();
+    gps_serial.begin(GPS_BAUD);
+
+    config.begin(); // before the GPS, it loads the drift file
 
     dlog.info(SETUP_TAG, F("initializing GPS"));
     display.message("Starting GPS");
@@ -166,14 +368,14 @@ void setup()
 
     bool force_config = false;
 
-    config.begin();
-
     if (!config.load())
     {
         dlog.warning(SETUP_TAG, "no config found, forcing config portal!");
         force_config = true;
     }
 
+    gps.setHoldoverLimit(config.getHoldoverLimit());
+
     // if the reset/config button is pressed then force config
     if (digitalRead(CONFIG_PIN) == 0)
     {
@@ -191,46 +393,28 @@ void setup()
         }
     }
 
+    dlog.info(SETUP_TAG, F("initializing NTP"));
+    ntp.begin();
+    ntp.setAccess(config.getAccessRules(), config.getAccessCount());
+
 #if !defined(USE_NO_WIFI)
     dlog.info(SETUP_TAG, F("initializing wifi"));
     display.message("Starting WiFi");
-    WiFiSetup wifi(config, display, Serial1, false, devicename);
-    wifi.connect(force_config);
-
-    const char* syslog_host = config.getSyslogHost();
-    uint16_t    syslog_port = config.getSyslogPort();
-    if (syslog_host != nullptr && strlen(syslog_host) > 0 && syslog_port != 0)
-    {
-        dlog.info(SETUP_TAG, "enabling syslog: '%s:%u'", syslog_host, syslog_port);
-        dlog.begin(new DLogSyslogWriter(syslog_host, syslog_port, devicename, ESPNTP_SERVER_VERSION));
-    }
-
-    dlog.info(SETUP_TAG, "ESP::FullVersion: %s", ESP.getFullVersion().c_str());
-
-    const char* url = wifi.getOTAURL();
-    const char* fp  = wifi.getOTAFP();
-    if (fp == nullptr)
-    {
-    	fp = "";
-    }
-
-    if (url != nullptr)
-    {
-    	processOTA(url, fp);
-    }
-
-    dlog.info(SETUP_TAG, F("WiFi mode: %d"), WiFi.getMode());
-    dlog.info(SETUP_TAG, F("wifi sleep mode: %d"), WiFi.getSleepMode());
+    wifi = new WiFiSetup(config, display, Serial1, false, devicename);
+    wifi->begin(force_config);
 #endif
 
     display.process();
-
-    dlog.info(SETUP_TAG, F("initializing NTP"));
-    ntp.begin();
+    bootPhase(BOOT_WIFI);
 }
 
 void loop()
 {
+    if (boot_state != BOOT_RUNNING)
+    {
+        boot();
+    }
+
     static int last_wifi_status;
     static IPAddress last_ip;
 
@@ -267,42 +451,107 @@ void loop()
     if (ip != last_ip)
     {
         dlog.warning(LOOP_TAG, F("ip address change %s -> %s"), last_ip.toString().c_str(), ip.toString().c_str());
-        if (ip == IPAddress(0,0,0,0))
+        last_ip = ip;
+    }
+
+#if !defined(USE_NO_WIFI)
+    //
+    // Once running, IP loss is handled in place: WiFiSetup reconnects with
+    // backoff while the GPS keeps going.  Reset only as a last resort.
+    //
+    if (boot_state == BOOT_RUNNING)
+    {
+        static bool ntp_unbound;
+        if (!wifi->process())
         {
-            dlog.error(LOOP_TAG, F("lost connectivity!  Resetting!"));
-            ESP.reset();
-            delay(10000);
+            ntp_unbound = true;
+            if (wifi->getOutageMs() > config.getWiFiResetTimeout() * 1000)
+            {
+                dlog.error(LOOP_TAG, F("no connectivity for %lu ms!  Resetting!"), wifi->getOutageMs());
+                ESP.reset();
+                delay(10000);
+            }
+        }
+        else if (ntp_unbound && millis() - boot_retry_ms >= NTP_LISTEN_RETRY_MS)
+        {
+            boot_retry_ms = millis();
+            ntp_unbound   = !ntp.rebind();
         }
-        last_ip = ip;
     }
+#endif
 
     gps.process();
+#if defined(GPS_CAPTURE)
+    capture.process();
+#endif
+
+    //
+    // boot to first answer, the number that warm restarts are meant to improve
+    //
+    static bool first_answer_logged;
+    if (!first_answer_logged && ntp.getFirstAnswerMs() != 0)
+    {
+        first_answer_logged = true;
+        dlog.info(LOOP_TAG, F("first NTP answer %lu ms after boot (resumes:%lu)"),
+                ntp.getFirstAnswerMs(), gps.getResumeCount());
+    }
 
     static time_t last_seconds;
-    struct timeval tv;
-    gps.getTime(&tv);
+    Timestamp ts;
+    gps.getTime(&ts);
+    time_t seconds = toEPOCH(TS_SECONDS(ts));
 
-    if (tv.tv_sec != last_seconds)
+    if (seconds != last_seconds)
     {
-        if (tv.tv_sec != last_seconds && ((tv.tv_sec % 300) == 0 || gps.getValidDelay()))
+        if (seconds != last_seconds && ((seconds % 300) == 0 || gps.getValidDelay()))
         {
-            dlog.info("loop", F("jitter:%lu valid_count:%lu valid:%s gpsvalid:%s numsat:%d heap:%ld valid_delay:%d"),
+            uint32_t outages = 0;
+#if !defined(USE_NO_WIFI)
+            outages = wifi->getOutages();
+#endif
+            dlog.info("loop", F("jitter:%lu valid_count:%lu valid:%s gpsvalid:%s holdover:%lu numsat:%d heap:%ld frag:%u%% maxblock:%lu valid_delay:%d ttv:%lu ppm:%.3f+/-%.3f ntp_cycles:%lu/%lu ntp_req:%lu rsp:%lu kod:%lu drop:%lu ignore:%lu outages:%lu"),
                     gps.getJitter(),
                     gps.getValidCount(),
                     gps.isValid() ? "true" : "false",
                     gps.isGPSValid() ? "true" : "false",
+                    gps.getHoldoverSeconds(),
                     gps.getSatelliteCount(),
                     ESP.getFreeHeap(),
-                    gps.getValidDelay());
+                    ESP.getHeapFragmentation(),
+                    ESP.getMaxFreeBlockSize(),
+                    gps.getValidDelay(),
+                    gps.getTimeToValid(),
+                    gps.getFrequencyPPM(),
+                    gps.getFrequencyUncertainty(),
+                    ntp.getCycles(),
+                    ntp.getMaxCycles(),
+                    ntp.getReqCount(),
+                    ntp.getRspCount(),
+                    ntp.getKoDCount(),
+                    ntp.getDropCount(),
+                    ntp.getIgnoreCount(),
+                    outages);
+            ntp.resetCycles();
+            if ((seconds % 300) == 0)
+            {
+                gps.logNMEAStats();
+                ntp.getClients().logClients("NTP");
+#if defined(NTP_RAW_UDP)
+                logRawUDP();
+#endif
+#if defined(NTP_LINK_STAMP)
+                logLinkStamps();
+#endif
+            }
         }
 
-        if (tv.tv_sec < last_seconds)
+        if (seconds < last_seconds)
         {
-            dlog.warning(LOOP_TAG, F("OOPS: time went backwards: last:%lu now:%lu delta:%ld"), last_seconds, tv.tv_sec, tv.tv_sec-last_seconds);
+            dlog.warning(LOOP_TAG, F("OOPS: time went backwards: last:%lu now:%lu delta:%ld"), last_seconds, seconds, seconds-last_seconds);
         }
 
         display.process();
     }
 
-    last_seconds = tv.tv_sec;
+    last_seconds = seconds;
 }
@@ -38,7 +38,10 @@
 #define SDA_PIN                4
 #define SCL_PIN                5
 
+#define GPS_BAUD               9600
+
 #define CONFIG_DELAY           1000  // how long to hold the button for config mode.
+#define NTP_LISTEN_RETRY_MS    1000  // retry binding the NTP port this often
 
 
 #endif /* _ESPNTPServer_H_ */
@@ -0,0 +1,138 @@
+/*
+ * FLL.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Jul 21, 2018
+ *      Author: chris.l
+ */
+
+#include <math.h>
+#include "FLL.h"
+#include "Timestamp.h"
+
+FLL::FLL(uint32_t nominal) :
+    _nominal(nominal),
+    _estimate(0),
+    _variance(0),
+    _samples(0),
+    _rejected(0),
+    _cycles_per_sec(0),
+    _frac_scale(0)
+{
+    reset();
+}
+
+FLL::~FLL()
+{
+}
+
+void FLL::reset()
+{
+    _estimate       = (int64_t)_nominal << FLL_SHIFT;
+    _variance       = 0;
+    _samples        = 0;
+    _cycles_per_sec = _nominal;
+    _frac_scale     = FRAC_SCALE(_nominal);
+}
+
+/*
+ * Start from a previously learned frequency error (parts per billion),
+ * e.g. from the drift file.  It is weighted as FLL_SEED_SAMPLES samples
+ * so the first PPS intervals refine it rather than replace it.
+ */
+void FLL::seed(int32_t ppb)
+{
+    reset();
+    if (ppb > FLL_MAX_PPM * 1000 || ppb < -FLL_MAX_PPM * 1000)
+    {
+        return;
+    }
+
+    uint64_t sd     = (uint64_t)_nominal * FLL_SEED_PPM / 1000000;
+    _estimate      += ((int64_t)_nominal * ppb << FLL_SHIFT) / 1000000000LL;
+    _variance       = sd * sd * FLL_SEED_SAMPLES;
+    _samples        = FLL_SEED_SAMPLES;
+    _cycles_per_sec = (uint32_t)((_estimate + (1 << (FLL_SHIFT-1))) >> FLL_SHIFT);
+    _frac_scale     = FRAC_SCALE(_cycles_per_sec);
+}
+
+/*
+ * Add a PPS interval (in cycles) to the estimate.  The first samples are
+ * a plain running average, after that an exponential average with weight
+ * FLL_MAX_WEIGHT.  Returns false if the interval was rejected as bogus
+ * (missed or extra edge).
+ */
+bool FLL::update(uint32_t interval)
+{
+    uint32_t limit = (uint32_t)(((uint64_t)_nominal * FLL_MAX_PPM) / 1000000);
+    int32_t  delta = (int32_t)(interval - _nominal);
+    if (delta > (int32_t)limit || delta < -(int32_t)limit)
+    {
+        ++_rejected;
+        return false;
+    }
+
+    int64_t  err  = ((int64_t)interval << FLL_SHIFT) - _estimate;
+    uint64_t err2 = (uint64_t)(err * err) >> (2*FLL_SHIFT);
+
+    if (_samples == 0)
+    {
+        // first sample, it is our best (only) estimate
+        _estimate = (int64_t)interval << FLL_SHIFT;
+        _samples  = 1;
+    }
+    else
+    {
+        if (_samples < FLL_MAX_WEIGHT)
+        {
+            ++_samples;
+        }
+        _estimate += err / (int64_t)_samples;
+        _variance  = (uint64_t)((int64_t)_variance + ((int64_t)err2 - (int64_t)_variance) / (int64_t)(_samples-1));
+    }
+
+    _cycles_per_sec = (uint32_t)((_estimate + (1 << (FLL_SHIFT-1))) >> FLL_SHIFT);
+    _frac_scale     = FRAC_SCALE(_cycles_per_sec);
+    return true;
+}
+
+/*
+ * Frequency error of the local oscillator, positive if it runs fast.
+ */
+double FLL::getPPM()
+{
+    return ((double)_estimate / (double)(1 << FLL_SHIFT) - (double)_nominal) * 1000000.0 / (double)_nominal;
+}
+
+/*
+ * Frequency error in parts per billion, for the drift file.
+ */
+int32_t FLL::getPPB()
+{
+    return (int32_t)((_estimate - ((int64_t)_nominal << FLL_SHIFT)) * 1000000000LL / ((int64_t)_nominal << FLL_SHIFT));
+}
+
+/*
+ * Standard error of the estimate.
+ */
+double FLL::getUncertaintyPPM()
+{
+    if (_samples < 2)
+    {
+        return FLL_MAX_PPM;
+    }
+    return sqrt((double)_variance / (double)_samples) * 1000000.0 / (double)_nominal;
+}
@@ -0,0 +1,66 @@
+/*
+ * FLL.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Jul 21, 2018
+ *      Author: chris.l
+ */
+
+#ifndef FLL_H_
+#define FLL_H_
+
+#include <stdint.h>
+
+#define FLL_MAX_PPM      500  // PPS intervals further than this from nominal are rejected
+#define FLL_MAX_WEIGHT   64   // steady state averaging weight (roughly the time constant in seconds)
+#define FLL_SHIFT        8    // fractional bits kept in the frequency estimate
+#define FLL_SEED_SAMPLES 8    // a seeded estimate counts as this many samples
+#define FLL_SEED_PPM     1    // assumed uncertainty of a seeded estimate
+
+//
+// Frequency locked loop: estimates the real number of CPU cycles per second
+// from successive PPS intervals so the sub-second interpolation can be scaled
+// by the crystal's actual frequency.
+//
+class FLL
+{
+public:
+    FLL(uint32_t nominal);
+    virtual ~FLL();
+
+    void     reset();
+    void     seed(int32_t ppb);
+    bool     update(uint32_t interval);
+
+    uint32_t getCyclesPerSec() { return _cycles_per_sec; }
+    uint32_t getFracScale()    { return _frac_scale; }
+    uint32_t getSamples()      { return _samples; }
+    uint32_t getRejected()     { return _rejected; }
+    double   getPPM();
+    int32_t  getPPB();
+    double   getUncertaintyPPM();
+
+private:
+    uint32_t _nominal;
+    int64_t  _estimate;        // cycles per second << FLL_SHIFT
+    uint64_t _variance;        // of the PPS interval in cycles^2
+    uint32_t _samples;
+    uint32_t _rejected;
+    uint32_t _cycles_per_sec;  // rounded _estimate
+    uint32_t _frac_scale;      // FRAC_SCALE() of _cycles_per_sec
+};
+
+#endif /* FLL_H_ */
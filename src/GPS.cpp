@@ -28,38 +28,62 @@
 #include "Log.h"
 static const char* TAG = "GPS";
 
-static std::function<void()> _pps;
-
-static ICACHE_RAM_ATTR void _pps_isr()
-{
-    if (_pps)
-    {
-        _pps();
-    }
-}
-
-static ICACHE_RAM_ATTR void _timer_handler(std::function<void()> *func)
-{
-    (*func)();
-}
-
-GPS::GPS(Stream& gps_stream, int pps_pin) :
+GPS::GPS(hal::SerialPort& gps_stream, hal::PinInterrupt& pps_pin, hal::Timer& pps_timer, Config& config) :
     _stream(gps_stream),
-    _nmea(_buffer, NMEA_BUFFER_SIZE),
-    _pps_timer(),
-    _seconds(0),
+    _pps_pin(pps_pin),
+    _pps_timer(pps_timer),
+    _config(config),
+    _nmea(),
+    _ubx(),
+    _state(),
+    _pps_seconds(0),
     _valid_delay(0),
+    _consistent(0),
+    _agreed(0),
+    _time_to_valid(0),
+    _valid_logged(0),
     _valid_count(0),
-    _min_micros(0),
-    _max_micros(0),
-    _last_micros(0),
+    _min_cycles(0),
+    _max_cycles(0),
+    _interval(0),
+    _edges(0),
+    _fll_edges(0),
+    _fll(CYCLES_PER_SEC),
     _timeouts(0),
-    _pps_pin(pps_pin),
+    _holdover_since(0),
+    _holdover_count(0),
+    _recovery_count(0),
+    _phase_lost(false),
+    _timed_out(TIMEOUT_NONE),
+    _phase_error(0),
+    _holdover_limit(HOLDOVER_LIMIT),
+    _drift_known(false),
+    _drift_ppb(0),
+    _drift_saved(0),
+    _drift_checked(0),
+    _resume_seconds(0),
+    _resume_count(0),
     _gps_valid(false),
-    _valid(false),
-    _nmea_late(true)
+    _sentence_stamped(false),
+    _sentence_cycles(0),
+    _frame_stamped(false),
+    _frame_cycles(0),
+    _unstamped(0),
+    _qerr_pending(false),
+    _qerr_frac(0),
+    _qerr_cycles(0),
+    _nmea_hist()
 {
     _reason[0] = '\0';
+    PPSSnapshot& s   = _state.beginWrite();
+    s.seconds        = 0;
+    s.edge_cycles    = 0;
+    s.cycles_per_sec = CYCLES_PER_SEC;
+    s.frac_scale     = FRAC_SCALE(CYCLES_PER_SEC);
+    s.qerr_frac      = 0;
+    s.valid          = false;
+    s.holdover       = false;
+    _state.endWrite();
 }
 
 GPS::~GPS()
@@ -69,41 +93,109 @@ GPS::~GPS()
 
 void GPS::begin()
 {
+#if defined(GPS_USE_UBX)
+    configure();
+#endif
+    loadDrift();
+    restore();
     PPS_TIMIMG_PIN_INIT();
-    _pps = std::bind( &GPS::pps, this);
-    _invalidate = std::bind( &GPS::timeout, this);
-    _nmea_timeout = std::bind( &GPS::nmeaTimeout, this);
-    _pps_timer.attach_ms(VALID_TIMER_MS, _timer_handler, &_invalidate);
-    pinMode(_pps_pin, INPUT);
-    attachInterrupt(_pps_pin, _pps_isr, RISING);
+    _pps_timer.setCallback(std::bind(&GPS::timeout, this));
+    _pps_timer.start(VALID_TIMER_MS);
+    _pps_pin.attach(std::bind(&GPS::pps, this));
 }
 
 void GPS::end()
 {
-    _pps_timer.detach();
-    detachInterrupt(_pps_pin);
-    _pps = nullptr;
+    _pps_timer.stop();
+    _pps_pin.detach();
+}
+
+void GPS::getTime(Timestamp* ts)
+{
+    PPSSnapshot snap;
+    _state.read(&snap);
+    getTime(snap, hal::cycles(), ts);
+}
+
+/*
+ * The time at a stamp taken earlier, which may be from before the edge
+ * the snapshot now holds.  Then it belongs to the second before.
+ */
+void GPS::getTime(uint32_t cycles, Timestamp* ts)
+{
+    PPSSnapshot snap;
+    _state.read(&snap);
+    if ((int32_t)(cycles - snap.edge_cycles) < 0)
+    {
+        snap.seconds     -= 1;
+        snap.edge_cycles -= snap.cycles_per_sec;
+    }
+    getTime(snap, cycles, ts);
 }
 
-void GPS::getTime(struct timeval* tv)
+/*
+ * Interpolate the time at CCOUNT value 'cycles' from a snapshot.
+ */
+void GPS::getTime(const PPSSnapshot& snap, uint32_t cur_cycles, Timestamp* ts)
 {
-    uint32_t cur_micros  = micros();
-    tv->tv_sec  = _seconds;
-    tv->tv_usec = (uint32_t)(cur_micros - _last_micros);
+    time_t   seconds    = snap.seconds;
+
+    //
+    // CCOUNT wraps every ~26s at 160MHz, the unsigned subtraction
+    // handles a single wrap which is all we can see between edges.
+    //
+    uint32_t cycles     = cur_cycles - snap.edge_cycles;
 
     //
-    // if micros_delta is at or bigger than one second then
-    // use the max just under 1 second.
+    // if the delta is at or bigger than one (measured) second then
+    // use the max just under 1 second, unless we are in holdover where
+    // the timer may not have synthesized the missing edge yet.
     //
-    if (tv->tv_usec >= 1000000 || tv->tv_usec < 0)
+    if (cycles >= snap.cycles_per_sec)
     {
-        tv->tv_usec = 999999;
+        if (snap.holdover)
+        {
+            seconds += cycles / snap.cycles_per_sec;
+            cycles   = cycles % snap.cycles_per_sec;
+        }
+        else
+        {
+            cycles = snap.cycles_per_sec-1;
+        }
     }
+
+    //
+    // the signed quantization correction may borrow from/carry into the seconds
+    //
+    *ts = TS_MAKE(toNTP(seconds), cycles2frac(cycles, snap.frac_scale)) + (int64_t)snap.qerr_frac;
 }
 
 double GPS::getDispersion()
 {
-    return us2s(MAX(abs(MICROS_PER_SEC-_max_micros), abs(MICROS_PER_SEC-_min_micros)));
+    return us2s(MAX(abs((int32_t)(CYCLES_PER_SEC-_max_cycles)), abs((int32_t)(CYCLES_PER_SEC-_min_cycles))) / CYCLES_PER_US);
+}
+
+uint32_t GPS::getHoldoverSeconds()
+{
+    PPSSnapshot snap;
+    _state.read(&snap);
+    return snap.holdover ? snap.seconds - _holdover_since : 0;
+}
+
+/*
+ * Root dispersion in NTP short format (16.16 seconds).  In holdover it
+ * grows with the time since the last PPS by the frequency tolerance plus
+ * the uncertainty of our frequency estimate.
+ */
+uint32_t GPS::getRootDispersion()
+{
+    uint32_t dispersion = 1; // ~15us, the floor we have always advertised
+    if (isHoldover())
+    {
+        double ppm = HOLDOVER_PHI_PPM + _fll.getUncertaintyPPM();
+        dispersion += (uint32_t)((double)getHoldoverSeconds() * ppm * 65536.0 / 1000000.0);
+    }
+    return dispersion;
 }
 
 void GPS::process()
@@ -114,116 +206,623 @@ void GPS::process()
         _reason[0] = '\0';
     }
 
+    if (_timed_out != TIMEOUT_NONE)
+    {
+        dlog.warning(TAG, F("REASON: timeout!%s"),
+                _timed_out == TIMEOUT_INVALID ? " not enough FLL samples for holdover" : "");
+        _timed_out = TIMEOUT_NONE;
+    }
+
+    if (_phase_lost)
+    {
+        dlog.warning(TAG, F("PPS returned out of phase by %ld cycles"), (long)_phase_error);
+        _phase_lost = false;
+    }
+
+    //
+    // let interested parties know about a new PPS edge (outside of interrupt context)
+    //
+    time_t seconds = getSeconds();
+    if (seconds != _pps_seconds)
+    {
+        _pps_seconds = seconds;
+        if (_on_pps)
+        {
+            _on_pps(seconds);
+        }
+        checkpoint();
+    }
+
+    if (_valid_count != _valid_logged)
+    {
+        _valid_logged = _valid_count;
+        dlog.info(TAG, F("valid after %lu seconds (%lu consistent edges, %lu labels agreed) %lu ms since boot"),
+                _time_to_valid, _consistent, _agreed, hal::millis());
+    }
+
+    //
+    // feed new PPS intervals to the FLL and publish the new scale
+    //
+    uint32_t edges = _edges;
+    if (edges != _fll_edges)
+    {
+        _fll_edges = edges;
+        if (_fll.update(_interval))
+        {
+            publishFLL();
+        }
+        else
+        {
+            dlog.debug(TAG, F("FLL rejected interval %lu"), _interval);
+        }
+        saveDrift();
+    }
+
+    //
+    // drain the serial port in bulk, the parser drops sentences we
+    // don't care about as soon as it sees their header.  For each '$'
+    // or UBX sync pick up the time it arrived from the receive interrupt.
+    // UBX frames are binary and never reach the NMEA parser.
+    //
+    char buffer[GPS_READ_SIZE];
     while (_stream.available() > 0)
     {
-    	int c = _stream.read();
-    	dlog.trace(TAG, F("c: %c"), c);
-        if (_nmea.process(c))
+        uint32_t index = _stream.getReadIndex();
+        size_t   len   = _stream.read(buffer, sizeof(buffer));
+        for (size_t i = 0; i < len; ++i)
         {
-            struct timeval tv;
-            getTime(&tv);
-            dlog.debug(TAG, F("'%s'"), _nmea.getSentence());
+            uint8_t c        = (uint8_t)buffer[i];
+            bool    in_frame = _ubx.inFrame();
 
-            const char * id = _nmea.getMessageID();
+            if (!in_frame && c == UBX_SYNC1)
+            {
+                _frame_stamped = _stream.getStamp(index + i, &_frame_cycles);
+            }
 
-            //
-            // if it was a RMC and its valid then check and maybe update the time
-            //
-            if (_nmea.getYear() > 2017 && strcmp("RMC", id) == 0)
+            if (_ubx.process(c))
             {
-                struct tm tm;
-                tm.tm_year  = _nmea.getYear() - 1900;
-                tm.tm_mon   = _nmea.getMonth() - 1;
-                tm.tm_mday  = _nmea.getDay();
-                tm.tm_hour  = _nmea.getHour();
-                tm.tm_min   = _nmea.getMinute();
-                tm.tm_sec   = _nmea.getSecond();
-                time_t new_seconds = mktime(&tm);
-
-                //
-                // we only update seconds if the message arrived in the last half of a second,
-                // if its in the first half then its most likely delayed from the previous second.
-                time_t old_seconds = _seconds;
-                if (old_seconds != new_seconds)
-                {
-                    if (!_nmea_late)
-                    {
-                        _seconds = new_seconds;
-                        invalidate("seconds adjusted!");
-                        dlog.info(TAG, F("adjusting seconds from %lu to %lu from:'%s'"), old_seconds, new_seconds, _nmea.getSentence());
-                    }
-                    else
-                    {
-                        dlog.debug(TAG, F("ignoring late NMEA time: '%s'"),_nmea.getSentence());
-                    }
-                }
-
-                _nmea_late = false;
-                _nmea_timer.attach_ms(NMEA_TIMER_MS, _timer_handler, &_nmea_timeout);
+                processUBX();
+                continue;
             }
 
-            if (_nmea.isValid() && _nmea.getNumSatellites() >= 4)
+            if (in_frame || _ubx.inFrame())
             {
-                //
-                // if gps was not valid, it is now
-                //
-                if (!_gps_valid)
-                {
-                    _valid_delay = VALID_DELAY;
-                    _gps_valid       = true;
-                    dlog.info(TAG, F("GPS valid!"));
-                }
+                continue;
             }
-            else /* nmea not valid or sat count < 4 */
+
+            if (c == '$')
             {
-                if (_gps_valid || _valid_delay)
-                {
-                    invalidate("NMEA:%s SATS:%d from: '%s'",
-                            _nmea.isValid() ? "valid" : "invalid",
-                            _nmea.getNumSatellites(), _nmea.getSentence());
-                }
+                _sentence_stamped = _stream.getStamp(index + i, &_sentence_cycles);
+            }
+
+            if (_nmea.process(buffer[i]))
+            {
+                processSentence();
             }
         }
     }
 }
 
-void GPS::nmeaTimeout()
+/*
+ * Start the FLL from the drift file so we don't have to learn the
+ * oscillator's frequency from scratch.
+ */
+void GPS::loadDrift()
 {
-    _nmea_late = true;
+    int32_t  ppb;
+    uint32_t saved;
+    if (!_config.loadDrift(&ppb, &saved))
+    {
+        return;
+    }
+
+    _fll.seed(ppb);
+    _drift_known = true;
+    _drift_ppb   = ppb;
+    _drift_saved = saved;
+    publishFLL();
+    dlog.info(TAG, F("FLL seeded with %ld ppb from drift file saved at %lu"), (long)ppb, (unsigned long)saved);
 }
 
 /*
- * Mark as not valid
+ * The drift file's age can only be checked once a time message has told
+ * us the time, if it is too old drop the seed before it carries us to
+ * valid and learn the frequency again.
  */
-void ICACHE_RAM_ATTR GPS::timeout()
+void GPS::checkDrift(time_t now)
 {
-    if (_valid)
+    uint32_t age = (uint32_t)(now - _drift_saved);
+    _drift_saved = 0;
+    if (age <= DRIFT_MAX_AGE)
     {
-        invalidate("timeout!");
+        return;
     }
-    _pps_timer.attach_ms(VALID_TIMER_MS, _timer_handler, &_invalidate);
+
+    _fll.reset();
+    _drift_known = false;
+    publishFLL();
+    dlog.warning(TAG, F("drift file is %lu seconds old, FLL seed dropped"), (unsigned long)age);
 }
 
 /*
- * Mark as not valid
+ * Write the drift file once the FLL has converged, at most once every
+ * DRIFT_SAVE_INTERVAL and only if it moved, to keep flash wear down.
  */
-void ICACHE_RAM_ATTR GPS::invalidate(const char* fmt, ...)
+void GPS::saveDrift()
+{
+    if (!isValid() || _fll.getSamples() < FLL_MAX_WEIGHT)
+    {
+        return;
+    }
+
+    time_t now = getSeconds();
+    if (_drift_checked != 0 && now - _drift_checked < DRIFT_SAVE_INTERVAL)
+    {
+        return;
+    }
+    _drift_checked = now;
+
+    int32_t ppb = _fll.getPPB();
+    if (_drift_known && abs(ppb - _drift_ppb) < DRIFT_SAVE_MIN_PPB)
+    {
+        return;
+    }
+
+    if (_config.saveDrift(ppb, now))
+    {
+        _drift_known = true;
+        _drift_ppb   = ppb;
+    }
+}
+
+/*
+ * Pick up the RTC memory checkpoint from before a soft reset.  If we were
+ * valid we resume on the first in-phase edge labelled by a time message.
+ */
+void GPS::restore()
+{
+    RTCCheckpoint cp;
+    if (!RTCCheckpointStore::load(&cp))
+    {
+        dlog.info(TAG, F("no RTC checkpoint, cold start"));
+        return;
+    }
+
+    _valid_count    = cp.valid_count;
+    _holdover_count = cp.holdover_count;
+    _recovery_count = cp.recovery_count;
+    _resume_count   = cp.resume_count;
+    _fll.seed(cp.ppb);
+    publishFLL();
+    if (cp.valid)
+    {
+        _resume_seconds = cp.seconds;
+    }
+    dlog.info(TAG, F("RTC checkpoint: seconds:%lu ppb:%ld valid:%d holdover:%d"),
+            (unsigned long)cp.seconds, (long)cp.ppb, cp.valid, cp.holdover);
+}
+
+/*
+ * Save the timing state to RTC memory, called once per second.  A pending
+ * resume is not overwritten until it is used or rejected.
+ */
+void GPS::checkpoint()
+{
+    if (_resume_seconds != 0)
+    {
+        return;
+    }
+
+    PPSSnapshot snap;
+    getSnapshot(&snap);
+
+    RTCCheckpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.seconds        = snap.seconds;
+    cp.ppb            = _fll.getPPB();
+    cp.valid_count    = _valid_count;
+    cp.holdover_count = _holdover_count;
+    cp.recovery_count = _recovery_count;
+    cp.resume_count   = _resume_count;
+    cp.valid          = snap.valid;
+    cp.holdover       = snap.holdover;
+    RTCCheckpointStore::save(&cp);
+}
+
+void GPS::publishFLL()
+{
+    PPSSnapshot& s   = _state.beginWrite();
+    s.cycles_per_sec = _fll.getCyclesPerSec();
+    s.frac_scale     = _fll.getFracScale();
+    _state.endWrite();
+}
+
+void GPS::processUBX()
+{
+    time_t  time;
+    int32_t qerr;
+
+    if (_ubx.getTimeUTC(&time))
+    {
+        label(time, _frame_stamped, _frame_cycles, "NAV-TIMEUTC");
+    }
+    else if (_ubx.getQuantizationError(&qerr) && _frame_stamped)
+    {
+        //
+        // TIM-TP describes the next pulse, pps() picks it up for the
+        // first edge after the frame arrived.
+        //
+        _qerr_pending = false;
+        _qerr_frac    = ps2frac(qerr);
+        _qerr_cycles  = _frame_cycles;
+        _qerr_pending = true;
+    }
+}
+
+void GPS::processSentence()
+{
+    dlog.debug(TAG, F("'%s'"), _nmea.getSentence());
+
+    //
+    // if it was a RMC/ZDA with a valid date then check and maybe update the time.
+    // The sentence carries the time of the PPS edge that came before its '$'.
+    //
+    if (_nmea.hasTime() && _nmea.getYear() > 2017)
+    {
+        label(_nmea.getTime(), _sentence_stamped, _sentence_cycles, _nmea.getSentence());
+    }
+
+    if (_nmea.isValid() && _nmea.getNumSatellites() >= 4)
+    {
+        //
+        // if gps was not valid, it is now
+        //
+        if (!_gps_valid)
+        {
+            _valid_delay = VALID_DELAY;
+            _agreed      = 0;
+            _gps_valid       = true;
+            dlog.info(TAG, F("GPS valid!"));
+        }
+    }
+    else /* nmea not valid or sat count < 4 */
+    {
+        if (isValid())
+        {
+            holdover("NMEA:%s SATS:%d from: '%s'",
+                    _nmea.isValid() ? "valid" : "invalid",
+                    _nmea.getNumSatellites(), _nmea.getSentence());
+        }
+        else if (_gps_valid || _valid_delay)
+        {
+            invalidate("NMEA:%s SATS:%d from: '%s'",
+                    _nmea.isValid() ? "valid" : "invalid",
+                    _nmea.getNumSatellites(), _nmea.getSentence());
+        }
+    }
+}
+
+/*
+ * Check the seconds against a time message that arrived at CCOUNT 'cycles'.
+ * The message carries the time of the PPS edge that came before it.
+ */
+void GPS::label(time_t time, bool stamped, uint32_t cycles, const char* from)
+{
+    if (!stamped)
+    {
+        ++_unstamped;
+        dlog.debug(TAG, F("no arrival time, can't label: '%s'"), from);
+        return;
+    }
+
+    PPSSnapshot snap;
+    getSnapshot(&snap);
+    if (snap.edge_cycles == 0)
+    {
+        return;     // no edge yet (or invalidated), there is no phase to measure
+    }
+
+    //
+    // phase of the message relative to the edge before it, more edges
+    // may have happened since if loop() was slow getting here.
+    //
+    time_t  edge_seconds = snap.seconds;
+    int32_t phase        = (int32_t)(cycles - snap.edge_cycles);
+    while (phase < 0)
+    {
+        phase += snap.cycles_per_sec;
+        --edge_seconds;
+    }
+
+    uint32_t bin = (uint32_t)phase / (snap.cycles_per_sec / NMEA_HIST_BINS);
+    ++_nmea_hist[MIN(bin, (uint32_t)NMEA_HIST_BINS)];
+
+    time_t new_seconds = time + (snap.seconds - edge_seconds);
+    time_t old_seconds = snap.seconds;
+    if (bin >= NMEA_HIST_BINS)
+    {
+        return;
+    }
+
+    if (_drift_saved != 0)
+    {
+        checkDrift(new_seconds);
+    }
+
+    //
+    // warm restart: the first labelled edge gives us the seconds back and
+    // if the checkpoint is recent we are valid again right away.
+    //
+    if (_resume_seconds != 0)
+    {
+        uint32_t age    = (uint32_t)(new_seconds - _resume_seconds);
+        _resume_seconds = 0;
+        if (age <= RTC_RESUME_MAX_AGE)
+        {
+            PPSSnapshot& s = _state.beginWrite();
+            s.seconds     += new_seconds - old_seconds; // an edge may have come since our snapshot
+            s.valid        = true;
+            s.holdover     = false;
+            _gps_valid     = true;
+            _valid_delay   = 0;
+            _time_to_valid = 0;
+            _valid_since   = s.seconds;
+            ++_valid_count;
+            ++_resume_count;
+            _state.endWrite();
+            dlog.info(TAG, F("resumed from RTC checkpoint %lu seconds old"), age);
+            return;
+        }
+        dlog.info(TAG, F("RTC checkpoint too old (%lu seconds), cold start"), age);
+    }
+
+    if (old_seconds == new_seconds)
+    {
+        ++_agreed;
+    }
+    else
+    {
+        _state.beginWrite().seconds = new_seconds;
+        _state.endWrite();
+        invalidate("seconds adjusted!");
+        dlog.info(TAG, F("adjusting seconds from %lu to %lu phase %ld cycles from:'%s'"),
+                old_seconds, new_seconds, (long)phase, from);
+    }
+}
+
+void GPS::logNMEAStats()
+{
+    dlog.info(TAG, F("time message phase (100ms bins): %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu >1s:%lu unstamped:%lu"),
+            _nmea_hist[0], _nmea_hist[1], _nmea_hist[2], _nmea_hist[3], _nmea_hist[4],
+            _nmea_hist[5], _nmea_hist[6], _nmea_hist[7], _nmea_hist[8], _nmea_hist[9],
+            _nmea_hist[NMEA_HIST_BINS], _unstamped);
+    dlog.info(TAG, F("serial: overflows:%lu fifo:%lu stamps:%lu skipped:%lu errors:%lu"),
+            _stream.getOverflows(), _stream.getFIFOOverflows(), _stream.getStampOverflows(),
+            _nmea.getSkipped(), _nmea.getErrors());
+    dlog.info(TAG, F("UBX: frames:%lu errors:%lu baud:%lu"),
+            _ubx.getFrames(), _ubx.getErrors(), _stream.getBaud());
+}
+
+#if defined(GPS_USE_UBX)
+/*
+ * Set up a u-blox receiver: just the NMEA we use, the UBX timing messages
+ * and a faster baud rate.  A receiver that does not ACK is left as it was.
+ */
+void GPS::configure()
+{
+    static const uint8_t nmea_off[] = {UBX_NMEA_GLL, UBX_NMEA_GSA, UBX_NMEA_GSV, UBX_NMEA_VTG, UBX_NMEA_ZDA};
+
+    uint32_t baud = _stream.getBaud();
+    if (!probe(baud))
+    {
+        dlog.warning(TAG, F("no UBX ACK, using NMEA only at %lu baud"), _stream.getBaud());
+        return;
+    }
+    setRate(UBX_CLASS_TIM, UBX_TIM_TP, 1);
+    for (size_t i = 0; i < sizeof(nmea_off); ++i)
+    {
+        setRate(UBX_CLASS_NMEA, nmea_off[i], 0);
+    }
+
+    if (_stream.getBaud() == GPS_UBX_BAUD)
+    {
+        dlog.info(TAG, F("u-blox already at %lu baud, UBX timing"), _stream.getBaud());
+        return;
+    }
+
+    //
+    // CFG-PRT for UART1: 8N1, UBX+NMEA in and out.  The ACK comes back at the
+    // new baud rate (if at all) so we check by repeating a CFG-MSG after.
+    //
+    uint8_t  prt[20];
+    memset(prt, 0, sizeof(prt));
+    prt[0]  = 1;     // UART1
+    prt[4]  = 0xd0;  // mode: 8 bits, no parity, 1 stop
+    prt[5]  = 0x08;
+    prt[8]  = (uint8_t)GPS_UBX_BAUD;
+    prt[9]  = (uint8_t)(GPS_UBX_BAUD >> 8);
+    prt[10] = (uint8_t)(GPS_UBX_BAUD >> 16);
+    prt[11] = (uint8_t)(GPS_UBX_BAUD >> 24);
+    prt[12] = 0x03;  // inProtoMask: UBX | NMEA
+    prt[14] = 0x03;  // outProtoMask: UBX | NMEA
+    sendUBX(UBX_CLASS_CFG, UBX_CFG_PRT, prt, sizeof(prt));
+    _stream.flush();
+    hal::delay(UBX_BAUD_SWITCH_MS);
+    _stream.setBaud(GPS_UBX_BAUD);
+
+    //
+    // no ACK does not tell us which side of the switch the receiver is on,
+    // ask again at both
+    //
+    if (!setRate(UBX_CLASS_TIM, UBX_TIM_TP, 1) && !probe(baud))
+    {
+        dlog.warning(TAG, F("u-blox lost after CFG-PRT, using NMEA only at %lu baud"), _stream.getBaud());
+        return;
+    }
+    dlog.info(TAG, F("u-blox configured, UBX timing at %lu baud"), _stream.getBaud());
+}
+
+/*
+ * Find the receiver's baud rate: GPS_UBX_BAUD first, it keeps that across
+ * an ESP reset, then 'baud' (what a receiver powers up at).  True with the
+ * port at the one that was ACKed, false with it back at 'baud'.
+ */
+bool GPS::probe(uint32_t baud)
+{
+    const uint32_t bauds[] = {GPS_UBX_BAUD, baud};
+    for (int i = 0; i < (baud == GPS_UBX_BAUD ? 1 : 2); ++i)
+    {
+        _stream.setBaud(bauds[i]);
+        if (setRate(UBX_CLASS_NAV, UBX_NAV_TIMEUTC, 1))
+        {
+            return true;
+        }
+    }
+    _stream.setBaud(baud);
+    return false;
+}
+
+/*
+ * CFG-MSG: output 'rate' per navigation solution on the current port.
+ */
+bool GPS::setRate(uint8_t cls, uint8_t id, uint8_t rate)
+{
+    uint8_t msg[3] = {cls, id, rate};
+    sendUBX(UBX_CLASS_CFG, UBX_CFG_MSG, msg, sizeof(msg));
+    return waitAck(UBX_CLASS_CFG, UBX_CFG_MSG);
+}
+
+void GPS::sendUBX(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len)
+{
+    uint8_t buffer[UBX_MAX_PAYLOAD+UBX_OVERHEAD];
+    _stream.write(buffer, UBX::frame(buffer, cls, id, payload, len));
+}
+
+/*
+ * Wait for the ACK (true) or NAK (false) of a CFG message, whatever
+ * else arrives meanwhile is dropped.
+ */
+bool GPS::waitAck(uint8_t cls, uint8_t id)
+{
+    uint32_t start = hal::millis();
+    while (hal::millis() - start < UBX_ACK_TIMEOUT_MS)
+    {
+        while (_stream.available() > 0)
+        {
+            if (_ubx.process((uint8_t)_stream.read()) && _ubx.getClass() == UBX_CLASS_ACK
+                    && _ubx.getLength() == 2 && _ubx.getPayload()[0] == cls && _ubx.getPayload()[1] == id)
+            {
+                return _ubx.getID() == UBX_ACK_ACK;
+            }
+        }
+        hal::yield();
+    }
+    return false;
+}
+#endif
+
+/*
+ * No PPS for a bit more than a second, go to holdover if we can.  In
+ * holdover we synthesize the missing edge from the FLL estimate and
+ * re-arm for just after the next predicted edge.
+ */
+void ICACHE_RAM_ATTR GPS::timeout()
+{
+    uint32_t ms = VALID_TIMER_MS;
+
+    if (_state.peek().valid)    // interrupt context, no write can be in progress
+    {
+        _timed_out = holdover() ? TIMEOUT_HOLDOVER : TIMEOUT_INVALID;   // process() logs it
+    }
+
+    PPSSnapshot& s = _state.beginWrite();
+    if (s.holdover)
+    {
+        s.seconds     += 1;
+        s.edge_cycles += s.cycles_per_sec;
+        s.qerr_frac    = 0;
+        int32_t remaining = (int32_t)(s.edge_cycles + s.cycles_per_sec - hal::cycles());
+        ms = remaining > 0 ? (uint32_t)remaining / (s.cycles_per_sec / 1000) + 1 : 1;
+    }
+    _state.endWrite();
+    _pps_timer.start(ms);
+}
+
+static void setReason(char* reason, const char* fmt, va_list ap)
 {
     //
     // only update the reason if there is not one already
     //
-    if (_reason[0] == '\0')
+    if (reason[0] == '\0')
+    {
+        vsnprintf(reason, REASON_SIZE-1, fmt, ap);
+        reason[REASON_SIZE-1] = '\0';
+    }
+}
+
+/*
+ * Mark as not valid, not from interrupt context (the reason is formatted).
+ */
+void GPS::invalidate(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    setReason(_reason, fmt, ap);
+    va_end(ap);
+    invalidate(_state.beginWrite());
+    _state.endWrite();
+}
+
+/*
+ * Mark as not valid, the caller has the state open for write.
+ */
+void ICACHE_RAM_ATTR GPS::invalidate(PPSSnapshot& state)
+{
+    state.valid       = false;
+    state.holdover    = false;
+    state.edge_cycles = 0;
+    _gps_valid        = false;
+    _valid_delay      = 0;
+    _consistent       = 0;
+    _agreed           = 0;
+}
+
+/*
+ * Lost GPS while valid, not from interrupt context (the reason is
+ * formatted).
+ */
+void GPS::holdover(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    setReason(_reason, fmt, ap);
+    va_end(ap);
+    holdover();
+}
+
+/*
+ * Keep serving on the FLL estimate if it has had enough samples, otherwise
+ * this is just an invalidate (and returns false).  Safe in interrupt
+ * context, the caller reports why.
+ */
+bool ICACHE_RAM_ATTR GPS::holdover()
+{
+    if (_fll.getSamples() < HOLDOVER_SAMPLES)
     {
-        va_list ap;
-        va_start(ap, fmt);
-        vsnprintf(_reason, REASON_SIZE-1, fmt, ap);
-        _reason[REASON_SIZE-1] = '\0';
-        va_end(ap);
+        invalidate(_state.beginWrite());
+        _state.endWrite();
+        return false;
     }
-    _valid       = false;
-    _gps_valid   = false;
-    _valid_delay = 0;
-    _last_micros = 0;
+
+    PPSSnapshot& s  = _state.beginWrite();
+    s.valid         = false;
+    s.holdover      = true;
+    _holdover_since = s.seconds;
+    _state.endWrite();
+    _gps_valid      = false;
+    _valid_delay    = 0;
+    ++_holdover_count;
+    return true;
 }
 
 /*
@@ -231,45 +830,111 @@ void ICACHE_RAM_ATTR GPS::invalidate(const char* fmt, ...)
  */
 void ICACHE_RAM_ATTR GPS::pps()
 {
+    //
+    // latch the cycle counter before anything else
+    //
+    uint32_t cur_cycles = hal::cycles();
+
     PPS_TIMING_PIN_ON();
 
-    uint32_t cur_micros = micros();
-    (void)cur_micros;
+    //
+    // restart the validity timer, if it runs out we invalidate our data.
+    //
+    _pps_timer.start(VALID_TIMER_MS);
+
+    PPSSnapshot& s = _state.beginWrite();
 
-#if 0
     //
-    // don't trust PPS if GPS is not valid.
+    // apply the TIM-TP quantization error if it was sent for this edge
     //
-    if (!_gps_valid)
+    s.qerr_frac = 0;
+    if (_qerr_pending)
     {
+        if (cur_cycles - _qerr_cycles < s.cycles_per_sec)
+        {
+            s.qerr_frac = _qerr_frac;
+        }
+        _qerr_pending = false;
+    }
+
+    //
+    // In holdover we check the edge against the predicted one.  If it is in
+    // phase and NMEA is good again we go straight back to valid, if it is
+    // out of phase our time can't be trusted any more.  The prediction is
+    // the last edge (when the timer already synthesized this one) or the one
+    // a second after it, anything else, a stale edge_cycles included, is out.
+    //
+    if (s.holdover)
+    {
+        int32_t since = (int32_t)(cur_cycles - s.edge_cycles);
+        int32_t next  = since - (int32_t)s.cycles_per_sec;
+        int32_t tol   = HOLDOVER_PHASE_US * CYCLES_PER_US;
+        if ((since >= -tol && since <= tol) || (next >= -tol && next <= tol))
+        {
+            if (since > tol)
+            {
+                s.seconds += 1;  // the timer has not synthesized this one yet
+            }
+            s.edge_cycles = cur_cycles;
+            if (_gps_valid)
+            {
+                s.holdover   = false;
+                s.valid      = true;
+                _valid_delay = 0;
+                ++_recovery_count;
+            }
+        }
+        else
+        {
+            _phase_error = (next < 0 ? -next : next) < (since < 0 ? -since : since) ? next : since;
+            _phase_lost  = true;
+            invalidate(s);
+            s.edge_cycles = cur_cycles;
+        }
+        _state.endWrite();
         PPS_TIMING_PIN_OFF();
         return;
     }
-#endif
 
     //
     // increment seconds
     //
-    _seconds += 1;
+    s.seconds += 1;
 
     //
-    // restart the validity timer, if it runs out we invalidate our data.
+    // count consecutive intervals that are plausible and close to the last one
     //
-    _pps_timer.attach_ms(VALID_TIMER_MS, &_timer_handler, &_invalidate);
+    uint32_t cycle_count = cur_cycles - s.edge_cycles;
+    if (s.edge_cycles != 0)
+    {
+        uint32_t deviation = cycle_count > _interval ? cycle_count - _interval : _interval - cycle_count;
+        uint32_t offset    = cycle_count > CYCLES_PER_SEC ? cycle_count - CYCLES_PER_SEC : CYCLES_PER_SEC - cycle_count;
+        if (deviation <= VALID_JITTER_US * CYCLES_PER_US && offset <= FLL_MAX_PPM * CYCLES_PER_US)
+        {
+            ++_consistent;
+        }
+        else
+        {
+            _consistent = 0;
+        }
+    }
 
     //
-    // if we are still counting down then keep waiting
+    // if we are still counting down then keep waiting, unless the PPS has
+    // been steady and the time messages agree with our seconds.
     //
     if (_valid_delay)
     {
         --_valid_delay;
-        if (_valid_delay == 0)
+        if (_valid_delay == 0 || (_consistent >= VALID_MIN_EDGES && _agreed >= VALID_MIN_LABELS))
         {
             // clear stats and mark us valid
-            _min_micros  = 0;
-            _max_micros  = 0;
-            _valid       = true;
-            _valid_since = _seconds;
+            _time_to_valid = VALID_DELAY - _valid_delay;
+            _valid_delay   = 0;
+            _min_cycles    = 0;
+            _max_cycles    = 0;
+            s.valid        = true;
+            _valid_since   = s.seconds;
             ++_valid_count;
         }
     }
@@ -277,26 +942,29 @@ void ICACHE_RAM_ATTR GPS::pps()
     //
     // the first time around we just initialize the last value
     //
-    if (_last_micros == 0)
+    if (s.edge_cycles == 0)
     {
-        _last_micros = cur_micros;
+        s.edge_cycles = cur_cycles;
+        _state.endWrite();
         PPS_TIMING_PIN_OFF();
         return;
     }
 
-    uint32_t micros_count = cur_micros - _last_micros;
-    _last_micros           = cur_micros;
+    s.edge_cycles        = cur_cycles;
+    _state.endWrite();
 
-    if (_min_micros == 0 || micros_count < _min_micros)
+    _interval            = cycle_count;
+    ++_edges;
+
+    if (_min_cycles == 0 || cycle_count < _min_cycles)
     {
-        _min_micros = micros_count;
+        _min_cycles = cycle_count;
     }
 
-    if (micros_count > _max_micros)
+    if (cycle_count > _max_cycles)
     {
-        _max_micros = micros_count;
+        _max_cycles = cycle_count;
     }
 
     PPS_TIMING_PIN_OFF();
 }
-
@@ -21,18 +21,47 @@
 
 #ifndef GPS_H_
 #define GPS_H_
-#include "Arduino.h"
-#include "MicroNMEA.h"
-#include "Ticker.h"
+#include "hal/HAL.h"
+#include "hal/SerialPort.h"
+#include "hal/PinInterrupt.h"
+#include "hal/Timer.h"
+#include "NMEAParser.h"
+#include "UBX.h"
+#include "Timestamp.h"
+#include "FLL.h"
+#include "SeqLock.h"
+#include "Config.h"
+#include "RTCCheckpoint.h"
 
 #define REASON_SIZE       128
-#define NMEA_BUFFER_SIZE  250
+#define GPS_READ_SIZE     64   // bytes drained from the serial port at a time
+#if defined(ARDUINO)
 #define PPS_TIMING_PIN    12   // (GPIO12) if defined PPS interrupt will make high during processing
-#define VALID_DELAY       120  // delay (seconds) from gps valid to valid
+#endif
+#define VALID_DELAY       120  // upper bound (seconds) from gps valid to valid
+#define VALID_MIN_EDGES   10   // consecutive consistent PPS intervals needed to go valid early
+#define VALID_MIN_LABELS  3    // time messages agreeing with our seconds needed to go valid early
+#define VALID_JITTER_US   10   // PPS interval may differ from the last by this much and be consistent
 #define VALID_TIMER_MS    1001 // if this timer expires we invalidate!
-#define NMEA_TIMER_MS     1100 // if this timer expires we mark NMEA time late
+#define NMEA_HIST_BINS    10   // NMEA '$' to PPS phase histogram, 100ms bins
+#define HOLDOVER_SAMPLES  16   // FLL samples needed before we allow holdover
+#define HOLDOVER_PHASE_US 50   // PPS within this of the predicted edge is "in phase"
+#define HOLDOVER_PHI_PPM  15   // RFC 5905 frequency tolerance added to the dispersion
+#define DRIFT_SAVE_INTERVAL 3600 // seconds between drift file writes (at most)
+#define DRIFT_SAVE_MIN_PPB  10   // only write the drift file if it changed by this much
+#define DRIFT_MAX_AGE       604800 // seconds, an older drift file is from another season, learn again
+#define RTC_RESUME_MAX_AGE  60   // resume valid from an RTC checkpoint at most this old (seconds)
+#define GPS_USE_UBX            // (u-blox) if defined configure the receiver and use UBX timing messages
+#define GPS_UBX_BAUD      115200 // baud rate we switch a u-blox receiver to
+#define UBX_ACK_TIMEOUT_MS 1000 // wait this long for a CFG ACK
+#define UBX_BAUD_SWITCH_MS 100  // let the receiver finish with CFG-PRT before we change baud
 
-#define MICROS_PER_SEC         1000000
+typedef enum
+{
+    TIMEOUT_NONE,
+    TIMEOUT_HOLDOVER,   // PPS timed out, went to holdover
+    TIMEOUT_INVALID     // PPS timed out, not enough FLL samples for holdover
+} TimeoutReason;
 
 #define us2s(x) (((double)x)/(double)MICROS_PER_SEC) // microseconds to seconds
 
@@ -50,57 +79,136 @@
 #define PPS_TIMING_PIN_OFF()
 #endif
 
+//
+// Everything a timestamp reader needs, published by the PPS interrupt
+// through a SeqLock so it is always seen as a consistent set.
+//
+typedef struct pps_snapshot
+{
+    time_t   seconds;         // seconds at the last (real or synthesized) edge
+    uint32_t edge_cycles;     // CCOUNT at the last edge
+    uint32_t cycles_per_sec;  // FLL estimate
+    uint32_t frac_scale;      // FRAC_SCALE() of cycles_per_sec
+    int32_t  qerr_frac;       // TIM-TP quantization error of the edge (NTP fraction)
+    bool     valid;
+    bool     holdover;        // no (trusted) PPS, free running on the FLL estimate
+} PPSSnapshot;
+
 class GPS
 {
 public:
-    GPS(Stream& gps_serial, int pps_pin);
+    GPS(hal::SerialPort& gps_serial, hal::PinInterrupt& pps_pin, hal::Timer& pps_timer, Config& config);
     virtual ~GPS();
 
     void     begin();
     void     process();
     void     end();
 
-    bool     isValid()       { return _valid; }
+    bool     isValid()       { PPSSnapshot s; _state.read(&s); return s.valid; }
     bool     isGPSValid()    { return _gps_valid; }
-    uint32_t getJitter()     { return _max_micros - _min_micros; }
+    bool     isHoldover()    { PPSSnapshot s; _state.read(&s); return s.holdover; }
+    bool     isHoldoverExpired() { return isHoldover() && getHoldoverSeconds() > _holdover_limit; }
+    uint32_t getHoldoverSeconds();
+    uint32_t getHoldoverCount()   { return _holdover_count; }
+    uint32_t getRecoveryCount()   { return _recovery_count; }
+    uint32_t getResumeCount()     { return _resume_count; }
+    void     setHoldoverLimit(uint32_t seconds) { _holdover_limit = seconds; }
+    uint32_t getJitter()     { return (_max_cycles - _min_cycles) / CYCLES_PER_US; }
     uint32_t getValidCount() { return _valid_count; }
     uint32_t getValidDelay() { return _valid_delay; }
+    uint32_t getTimeToValid() { return _time_to_valid; }
     time_t   getValidSince() { return _valid_since; }
     uint8_t  getSatelliteCount() { return _nmea.getNumSatellites(); }
-    time_t   getSeconds()        { return _seconds; }
-    void     getTime(struct timeval* tv);
+    time_t   getSeconds()        { PPSSnapshot s; _state.read(&s); return s.seconds; }
+    void     getSnapshot(PPSSnapshot* snap) { _state.read(snap); }
+    uint32_t getSnapshotRetries()           { return _state.getRetries(); }
+    void     getTime(Timestamp* ts);
+    void     getTime(uint32_t cycles, Timestamp* ts);    // at a cycles() taken a moment ago
+    static void getTime(const PPSSnapshot& snap, uint32_t cycles, Timestamp* ts);
     double   getDispersion();
+    uint32_t getRootDispersion();
+    double   getFrequencyPPM()         { return _fll.getPPM(); }            // estimated oscillator error
+    double   getFrequencyUncertainty() { return _fll.getUncertaintyPPM(); } // in ppm
+    void     onPPS(std::function<void(time_t)> callback) { _on_pps = callback; }
+    void     logNMEAStats();
 
     // we don't allow copying this guy!
     GPS(const GPS&)            = delete;
     GPS& operator=(const GPS&) = delete;
 
 private:
-    Stream&           _stream;
-    char              _buffer[NMEA_BUFFER_SIZE];
-    MicroNMEA         _nmea;
-    Ticker            _pps_timer;
-    Ticker            _nmea_timer;
-    std::function<void()> _invalidate;
-    std::function<void()> _nmea_timeout;
-    volatile time_t   _seconds;
+    friend class Benchmark;  // times the private hot paths
+
+    hal::SerialPort&  _stream;
+    hal::PinInterrupt& _pps_pin;
+    hal::Timer&       _pps_timer;
+    Config&           _config;
+    NMEAParser        _nmea;
+    std::function<void(time_t)> _on_pps;
+    UBX               _ubx;
+    SeqLock<PPSSnapshot> _state;
+    time_t            _pps_seconds;  // last seconds value passed to _on_pps
     volatile uint32_t _valid_delay;  // delay (seconds) from gps_valid until we thing we are valid
+    volatile uint32_t _consistent;   // consecutive PPS intervals within VALID_JITTER_US
+    volatile uint32_t _agreed;       // time messages that agreed with our seconds since gps_valid
+    volatile uint32_t _time_to_valid; // seconds from gps_valid to valid, last transition
+    uint32_t          _valid_logged; // _valid_count last logged
     volatile uint32_t _valid_count;  // number of times we have gone valid
     volatile time_t   _valid_since;
-    volatile uint32_t _min_micros;
-    volatile uint32_t _max_micros;
-    volatile uint32_t _last_micros;
+    volatile uint32_t _min_cycles;   // shortest PPS interval seen
+    volatile uint32_t _max_cycles;   // longest PPS interval seen
+    volatile uint32_t _interval;     // cycles between the last two PPS edges
+    volatile uint32_t _edges;        // number of PPS intervals measured
+    uint32_t          _fll_edges;    // _edges last handed to the FLL
+    FLL               _fll;
     volatile uint32_t _timeouts;
+    volatile time_t   _holdover_since;
+    volatile uint32_t _holdover_count;  // number of times we entered holdover
+    volatile uint32_t _recovery_count;  // number of times PPS returned in phase
+    volatile bool     _phase_lost;      // PPS returned out of phase, process() logs _phase_error
+    volatile uint8_t  _timed_out;       // TimeoutReason for process() to log
+    volatile int32_t  _phase_error;     // cycles from the nearest predicted edge
+    uint32_t          _holdover_limit;
+    bool              _drift_known;  // _drift_ppb is what is in the drift file
+    int32_t           _drift_ppb;
+    uint32_t          _drift_saved;   // when the seed was saved, checked once we know the time (0 = done)
+    time_t            _drift_checked; // seconds we last considered writing the drift file
+    time_t            _resume_seconds; // valid RTC checkpoint to resume from (0 = none)
+    uint32_t          _resume_count;   // number of warm restarts resumed from RTC memory
 
-    uint8_t           _pps_pin;
     bool              _gps_valid;
-    volatile bool     _valid;
-    volatile bool     _nmea_late;
+    bool              _sentence_stamped;  // _sentence_cycles is valid for the current sentence
+    uint32_t          _sentence_cycles;   // CCOUNT when the current sentence's '$' arrived
+    bool              _frame_stamped;     // _frame_cycles is valid for the current UBX frame
+    uint32_t          _frame_cycles;      // CCOUNT when the current UBX frame's sync arrived
+    uint32_t          _unstamped;         // time messages we could not label (no arrival time)
+    volatile bool     _qerr_pending;      // _qerr_frac is for the edge after _qerr_cycles
+    volatile int32_t  _qerr_frac;
+    volatile uint32_t _qerr_cycles;       // CCOUNT when the TIM-TP arrived
+    uint32_t          _nmea_hist[NMEA_HIST_BINS+1]; // last bin is >= 1s
     char              _reason[REASON_SIZE];
     void pps();        // interrupt handler
     void timeout();
     void invalidate(const char* fmt, ...);
-    void nmeaTimeout();
+    void invalidate(PPSSnapshot& state);
+    void holdover(const char* fmt, ...);
+    bool holdover();
+    void processSentence();
+    void processUBX();
+    void loadDrift();
+    void checkDrift(time_t now);
+    void saveDrift();
+    void restore();
+    void checkpoint();
+    void publishFLL();
+    void label(time_t time, bool stamped, uint32_t cycles, const char* from);
+#if defined(GPS_USE_UBX)
+    void configure();
+    bool probe(uint32_t baud);
+    bool setRate(uint8_t cls, uint8_t id, uint8_t rate);
+    void sendUBX(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len);
+    bool waitAck(uint8_t cls, uint8_t id);
+#endif
 };
 
 #endif /* GPS_H_ */
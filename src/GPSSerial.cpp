@@ -0,0 +1,232 @@
+/*
+ * GPSSerial.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 11, 2018
+ *      Author: chris.l
+ */
+
+#include "GPSSerial.h"
+#include "Timestamp.h"
+#include "esp8266_peri.h"
+#include "user_interface.h"
+
+#define GPS_UART        0
+#define UART_CONFIG_8N1 ((3 << UCBN) | (1 << UCSBN))
+#define UART_TX_FIFO    0x7f
+
+GPSSerial::GPSSerial() :
+    _head(0),
+    _tail(0),
+    _stamp_head(0),
+    _stamp_tail(0),
+    _overflows(0),
+    _fifo_overflows(0),
+    _stamp_overflows(0),
+    _baud(0),
+    _char_cycles(0)
+{
+}
+
+GPSSerial::~GPSSerial()
+{
+    end();
+}
+
+void GPSSerial::begin(uint32_t baud)
+{
+    ETS_UART_INTR_DISABLE();
+
+    //
+    // same pins as Serial.swap(): RX on GPIO13, TX on GPIO15
+    //
+    pinMode(15, FUNCTION_4);
+    pinMode(13, FUNCTION_4);
+    IOSWAP |= (1 << IOSWAPU0);
+
+    setBaud(baud);
+    USC0(GPS_UART) = UART_CONFIG_8N1 | (1 << UCRXRST) | (1 << UCTXRST);
+    USC0(GPS_UART) = UART_CONFIG_8N1;
+
+    //
+    // interrupt on every byte so the '$' timestamps are accurate
+    //
+    USC1(GPS_UART) = (1 << UCFFT) | (2 << UCTOT) | (1U << UCTOE);
+    USIC(GPS_UART) = 0xffff;
+    USIE(GPS_UART) = (1 << UIFF) | (1 << UIOF) | (1 << UITO);
+
+    ETS_UART_INTR_ATTACH(_isr, this);
+    ETS_UART_INTR_ENABLE();
+}
+
+void GPSSerial::end()
+{
+    ETS_UART_INTR_DISABLE();
+    USIE(GPS_UART) = 0;
+    USIC(GPS_UART) = 0xffff;
+}
+
+/*
+ * Change the baud rate, the caller should flush() first.
+ */
+void GPSSerial::setBaud(uint32_t baud)
+{
+    _baud          = baud;
+    _char_cycles   = CYCLES_PER_SEC / baud * 10;
+    USD(GPS_UART)  = ESP8266_CLOCK / baud;
+}
+
+int GPSSerial::available()
+{
+    return (int)(_head - _tail);
+}
+
+int GPSSerial::peek()
+{
+    if (_head == _tail)
+    {
+        return -1;
+    }
+    return _rx[_tail & (GPS_SERIAL_RX_SIZE-1)];
+}
+
+int GPSSerial::read()
+{
+    if (_head == _tail)
+    {
+        return -1;
+    }
+    int c = _rx[_tail & (GPS_SERIAL_RX_SIZE-1)];
+    ++_tail;
+    return c;
+}
+
+size_t GPSSerial::read(char* buffer, size_t size)
+{
+    uint32_t tail  = _tail;
+    size_t   count = _head - tail;
+    if (count > size)
+    {
+        count = size;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        buffer[i] = (char)_rx[(tail + i) & (GPS_SERIAL_RX_SIZE-1)];
+    }
+    _tail = tail + count;
+    return count;
+}
+
+size_t GPSSerial::write(uint8_t c)
+{
+    while (((USS(GPS_UART) >> USTXC) & 0xff) >= UART_TX_FIFO)
+    {
+        yield();
+    }
+    USF(GPS_UART) = c;
+    return 1;
+}
+
+size_t GPSSerial::write(const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        write(data[i]);
+    }
+    return len;
+}
+
+void GPSSerial::flush()
+{
+    while (((USS(GPS_UART) >> USTXC) & 0xff) != 0)
+    {
+        yield();
+    }
+}
+
+/*
+ * Find the arrival time of the '$' or 0xb5 at stream index 'index', older
+ * stamps are discarded.
+ */
+bool GPSSerial::getStamp(uint32_t index, uint32_t* cycles)
+{
+    while (_stamp_tail != _stamp_head)
+    {
+        Stamp& stamp = _stamps[_stamp_tail & (GPS_SERIAL_STAMP_SIZE-1)];
+        int32_t diff = (int32_t)(stamp.index - index);
+        if (diff > 0)
+        {
+            return false;  // stamp is for a later byte, ours was dropped
+        }
+        ++_stamp_tail;
+        if (diff == 0)
+        {
+            *cycles = stamp.cycles;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ICACHE_RAM_ATTR GPSSerial::_isr(void* arg)
+{
+    ((GPSSerial*)arg)->isr();
+}
+
+void ICACHE_RAM_ATTR GPSSerial::isr()
+{
+    uint32_t now    = ESP.getCycleCount();
+    uint32_t status = USIS(GPS_UART);
+
+    if (status & (1 << UIOF))
+    {
+        ++_fifo_overflows;
+    }
+
+    //
+    // byte k of n in the FIFO started arriving (n-k) character times ago
+    //
+    uint32_t n = (USS(GPS_UART) >> USRXC) & 0xff;
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        uint8_t c = USF(GPS_UART);
+        if (_head - _tail >= GPS_SERIAL_RX_SIZE)
+        {
+            ++_overflows;
+            continue;
+        }
+
+        if (c == '$' || c == 0xb5)
+        {
+            if (_stamp_head - _stamp_tail >= GPS_SERIAL_STAMP_SIZE)
+            {
+                ++_stamp_overflows;
+            }
+            else
+            {
+                Stamp& stamp = _stamps[_stamp_head & (GPS_SERIAL_STAMP_SIZE-1)];
+                stamp.index  = _head;
+                stamp.cycles = now - (n - k) * _char_cycles;
+                ++_stamp_head;
+            }
+        }
+
+        _rx[_head & (GPS_SERIAL_RX_SIZE-1)] = c;
+        ++_head;
+    }
+
+    USIC(GPS_UART) = status;
+}
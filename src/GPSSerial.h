@@ -0,0 +1,89 @@
+/*
+ * GPSSerial.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 11, 2018
+ *      Author: chris.l
+ */
+
+#ifndef GPSSERIAL_H_
+#define GPSSERIAL_H_
+
+#include "hal/SerialPort.h"
+
+#define GPS_SERIAL_RX_SIZE     256  // receive ring, must be a power of 2
+#define GPS_SERIAL_STAMP_SIZE  16   // '$'/UBX sync timestamp ring, must be a power of 2
+
+//
+// Interrupt driven receiver for UART0 (swapped to GPIO13/15) that replaces
+// HardwareSerial for the GPS.  The RX interrupt fires for every byte so we
+// can latch CCOUNT when each '$' (start of an NMEA sentence) or 0xb5 (UBX
+// sync) arrives.
+//
+class GPSSerial : public hal::SerialPort
+{
+public:
+    GPSSerial();
+    virtual ~GPSSerial();
+
+    void     begin(uint32_t baud);
+    void     end();
+    void     setBaud(uint32_t baud) override;
+    uint32_t getBaud() override           { return _baud; }
+
+    int      available() override;
+    int      read() override;
+    int      peek();
+    size_t   read(char* buffer, size_t size) override;
+    size_t   write(uint8_t c);
+    size_t   write(const uint8_t* data, size_t len) override;
+    void     flush() override;
+
+    uint32_t getReadIndex() override      { return _tail; }
+    bool     getStamp(uint32_t index, uint32_t* cycles) override;
+
+    uint32_t getOverflows() override      { return _overflows; }
+    uint32_t getFIFOOverflows() override  { return _fifo_overflows; }
+    uint32_t getStampOverflows() override { return _stamp_overflows; }
+
+    // we don't allow copying this guy!
+    GPSSerial(const GPSSerial&)            = delete;
+    GPSSerial& operator=(const GPSSerial&) = delete;
+
+private:
+    typedef struct stamp
+    {
+        uint32_t index;   // stream index of the '$' or 0xb5
+        uint32_t cycles;  // CCOUNT when its start bit arrived
+    } Stamp;
+
+    volatile uint32_t _head;           // bytes received
+    volatile uint32_t _tail;           // bytes read
+    uint8_t           _rx[GPS_SERIAL_RX_SIZE];
+    volatile uint32_t _stamp_head;
+    volatile uint32_t _stamp_tail;
+    Stamp             _stamps[GPS_SERIAL_STAMP_SIZE];
+    volatile uint32_t _overflows;
+    volatile uint32_t _fifo_overflows;
+    volatile uint32_t _stamp_overflows;
+    uint32_t          _baud;
+    uint32_t          _char_cycles;    // cycles for one character (10 bits)
+
+    void        isr();
+    static void _isr(void* arg);
+};
+
+#endif /* GPSSERIAL_H_ */
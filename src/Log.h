@@ -22,7 +22,11 @@
 #ifndef LOG_H_
 #define LOG_H_
 
+#if defined(ARDUINO)
 #include "DLog.h"
+#else
+#include "hal/posix/PosixLog.h"
+#endif
 
 extern DLog& dlog;
 
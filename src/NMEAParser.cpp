@@ -0,0 +1,274 @@
+/*
+ * NMEAParser.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 4, 2018
+ *      Author: chris.l
+ */
+
+#include <string.h>
+#include "NMEAParser.h"
+
+#define HEADER_LEN  6   // "$GPRMC"
+
+static inline uint32_t digit(char c)
+{
+    return (uint32_t)(c - '0');
+}
+
+static inline uint32_t two(const char* p)
+{
+    return digit(p[0]) * 10 + digit(p[1]);
+}
+
+static inline int hex(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+//
+// start of the n'th field (0 is the header) or nullptr
+//
+static const char* field(const char* s, int n)
+{
+    while (s != nullptr && n > 0)
+    {
+        s = strchr(s, ',');
+        if (s == nullptr)
+        {
+            return nullptr;
+        }
+        ++s;
+        --n;
+    }
+    return s;
+}
+
+static inline bool isdigits(const char* p, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        if (p[i] < '0' || p[i] > '9')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+NMEAParser::NMEAParser() :
+    _state(WAIT),
+    _len(0),
+    _checksum(0),
+    _received(0),
+    _digits(0),
+    _pending(NONE),
+    _message(NONE),
+    _has_time(false),
+    _time(0),
+    _year(0),
+    _valid(false),
+    _sats(0),
+    _skipped(0),
+    _errors(0)
+{
+    _sentence[0] = '\0';
+    _id[0]       = '\0';
+}
+
+NMEAParser::~NMEAParser()
+{
+}
+
+/*
+ * Days since 1970-01-01 for a proleptic Gregorian date, integer only.
+ * (Howard Hinnant's days_from_civil)
+ */
+int32_t NMEAParser::daysFromCivil(int32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    const int32_t  era = (y >= 0 ? y : y-399) / 400;
+    const uint32_t yoe = (uint32_t)(y - era * 400);
+    const uint32_t doy = (153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d-1;
+    const uint32_t doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+bool NMEAParser::process(char c)
+{
+    if (c == '$')
+    {
+        _state    = HEADER;
+        _len      = 0;
+        _checksum = 0;
+        _sentence[_len++] = c;
+        return false;
+    }
+
+    switch (_state)
+    {
+        case WAIT:
+            return false;
+
+        case HEADER:
+            _checksum ^= c;
+            _sentence[_len++] = c;
+            if (_len == HEADER_LEN)
+            {
+                const char* type = &_sentence[3];
+                if (memcmp(type, "RMC", 3) == 0)
+                {
+                    _pending = RMC;
+                }
+                else if (memcmp(type, "ZDA", 3) == 0)
+                {
+                    _pending = ZDA;
+                }
+                else if (memcmp(type, "GGA", 3) == 0)
+                {
+                    _pending = GGA;
+                }
+                else
+                {
+                    ++_skipped;
+                    _state = WAIT;
+                    return false;
+                }
+                _state = BODY;
+            }
+            return false;
+
+        case BODY:
+            if (c == '*')
+            {
+                _sentence[_len] = '\0';
+                _received       = 0;
+                _digits         = 0;
+                _state          = CHECKSUM;
+                return false;
+            }
+            if (c == '\r' || c == '\n' || _len >= NMEA_SENTENCE_SIZE-1)
+            {
+                ++_errors;
+                _state = WAIT;
+                return false;
+            }
+            _checksum ^= c;
+            _sentence[_len++] = c;
+            return false;
+
+        case CHECKSUM:
+        {
+            int h = hex(c);
+            if (h < 0)
+            {
+                ++_errors;
+                _state = WAIT;
+                return false;
+            }
+            _received = (_received << 4) | h;
+            if (++_digits < 2)
+            {
+                return false;
+            }
+            _state = WAIT;
+            if (_received != _checksum)
+            {
+                ++_errors;
+                return false;
+            }
+            parse();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void NMEAParser::parse()
+{
+    _message  = _pending;
+    _has_time = false;
+    memcpy(_id, &_sentence[3], 3);
+    _id[3]    = '\0';
+
+    const char* t = field(_sentence, 1);
+    uint32_t    day = 0, month = 0;
+    int32_t     year = 0;
+
+    switch (_message)
+    {
+        case RMC:
+        {
+            const char* status = field(_sentence, 2);
+            const char* date   = field(_sentence, 9);
+            _valid = status != nullptr && *status == 'A';
+            if (date != nullptr && isdigits(date, 6))
+            {
+                day   = two(date);
+                month = two(date+2);
+                year  = 2000 + two(date+4);
+            }
+            break;
+        }
+
+        case ZDA:
+        {
+            const char* d = field(_sentence, 2);
+            const char* m = field(t, 2);
+            const char* y = field(t, 3);
+            if (d != nullptr && m != nullptr && y != nullptr && isdigits(d, 2) && isdigits(m, 2) && isdigits(y, 4))
+            {
+                day   = two(d);
+                month = two(m);
+                year  = two(y) * 100 + two(y+2);
+            }
+            break;
+        }
+
+        case GGA:
+        {
+            const char* quality = field(_sentence, 6);
+            const char* sats    = field(quality, 1);
+            _valid = quality != nullptr && *quality != '0' && *quality != ',';
+            _sats  = 0;
+            while (sats != nullptr && *sats >= '0' && *sats <= '9')
+            {
+                _sats = _sats * 10 + digit(*sats++);
+            }
+            return;
+        }
+
+        default:
+            return;
+    }
+
+    if (year != 0 && t != nullptr && isdigits(t, 6) && month >= 1 && month <= 12 && day >= 1 && day <= 31)
+    {
+        _year     = (uint16_t)year;
+        _time     = (time_t)daysFromCivil(year, month, day) * 86400
+                  + two(t) * 3600 + two(t+2) * 60 + two(t+4);
+        _has_time = true;
+    }
+}
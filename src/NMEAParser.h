@@ -0,0 +1,93 @@
+/*
+ * NMEAParser.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 4, 2018
+ *      Author: chris.l
+ */
+
+#ifndef NMEAPARSER_H_
+#define NMEAPARSER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#define NMEA_SENTENCE_SIZE 100  // NMEA 0183 says 82 max, leave some slack
+
+//
+// Minimal NMEA parser that only looks at what we need for time: RMC and ZDA
+// for the time/date and validity, GGA for the satellite count.  Anything else
+// is dropped as soon as its header is seen.
+//
+class NMEAParser
+{
+public:
+    typedef enum
+    {
+        NONE = 0,
+        RMC,
+        ZDA,
+        GGA
+    } Message;
+
+    NMEAParser();
+    virtual ~NMEAParser();
+
+    bool        process(char c);  // true when a wanted sentence with a good checksum is complete
+
+    Message     getMessage()        { return _message; }
+    const char* getMessageID()      { return _id; }
+    const char* getSentence()       { return _sentence; }
+    bool        hasTime()           { return _has_time; }
+    time_t      getTime()           { return _time; }
+    uint16_t    getYear()           { return _year; }
+    bool        isValid()           { return _valid; }
+    uint8_t     getNumSatellites()  { return _sats; }
+    uint32_t    getSkipped()        { return _skipped; }
+    uint32_t    getErrors()         { return _errors; }
+
+    static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d);
+
+private:
+    typedef enum
+    {
+        WAIT,      // waiting for '$'
+        HEADER,    // talker and message id
+        BODY,      // fields up to '*'
+        CHECKSUM   // two hex digits
+    } State;
+
+    State    _state;
+    char     _sentence[NMEA_SENTENCE_SIZE];
+    uint8_t  _len;
+    uint8_t  _checksum;
+    uint8_t  _received;    // checksum from the sentence
+    uint8_t  _digits;
+    Message  _pending;
+    Message  _message;
+    char     _id[4];
+    bool     _has_time;
+    time_t   _time;
+    uint16_t _year;
+    bool     _valid;
+    uint8_t  _sats;
+    uint32_t _skipped;
+    uint32_t _errors;
+
+    void     parse();
+};
+
+#endif /* NMEAPARSER_H_ */
@@ -20,7 +20,8 @@
  */
 
 #include <functional>
-#include <lwip/def.h> // htonl() & ntohl()
+#include <stddef.h>
+#include <math.h>
 
 #include "NTP.h"
 
@@ -32,21 +33,6 @@ static const char* TAG = "NTP";
 #define NTP_PORT               123
 #define PRECISION_COUNT        10000
 
-typedef struct ntp_packet
-{
-    uint8_t  flags;
-    uint8_t  stratum;
-    uint8_t  poll;
-    int8_t   precision;
-    uint32_t delay;
-    uint32_t dispersion;
-    uint8_t  ref_id[4];
-    NTPTime  ref_time;
-    NTPTime  orig_time;
-    NTPTime  recv_time;
-    NTPTime  xmit_time;
-} NTPPacket;
-
 #define LI_NONE         0
 #define LI_SIXTY_ONE    1
 #define LI_FIFTY_NINE   2
@@ -64,6 +50,11 @@ typedef struct ntp_packet
 #define NTP_VERSION     4
 
 #define REF_ID          "PPS "  // "GPS " when we have one!
+#define KOD_RATE        "RATE"  // kiss code: slow down
+#define KOD_DENY        "DENY"  // kiss code: access denied, stop asking
+
+#define STRATUM_KOD     0
+#define STRATUM_NOSYNC  16
 
 #define setLI(value)    ((value&0x03)<<6)
 #define setVERS(value)  ((value&0x07)<<3)
@@ -73,10 +64,6 @@ typedef struct ntp_packet
 #define getVERS(value)  ((value>>3)&0x07)
 #define getMODE(value)  (value&0x07)
 
-#define SEVENTY_YEARS   2208988800L
-#define toEPOCH(t)      ((uint32_t)t-SEVENTY_YEARS)
-#define toNTP(t)        ((uint32_t)t+SEVENTY_YEARS)
-
 #ifdef NTP_PACKET_DEBUG
 #include <time.h>
 char* timestr(long int t)
@@ -107,12 +94,22 @@ void dumpNTPPacket(NTPPacket* ntp)
 #define dumpNTPPacket(x)
 #endif
 
-NTP::NTP(GPS& gps) :
+NTP::NTP(GPS& gps, hal::UDPEndpoint& udp) :
     _gps(gps),
-    _udp(),
+    _udp(udp),
     _req_count(0),
     _rsp_count(0),
-    _precision(0)
+    _precision(0),
+    _cycles(0),
+    _max_cycles(0),
+    _first_answer_ms(0),
+    _kod_count(0),
+    _drop_count(0),
+    _ignore_count(0),
+    _rate_limit(true),
+    _access(),
+    _clients(),
+    _template()
 {
 }
 
@@ -123,100 +120,309 @@ NTP::~NTP()
 void NTP::begin()
 {
     _precision = computePrecision();
-    while (!_udp.listen(NTP_PORT))
+    initTemplate();
+    _gps.onPPS(std::bind(&NTP::updateTemplate, this, std::placeholders::_1));
+}
+
+/*
+ * Start serving, needs an IP address.  Returns false if we could not
+ * bind, the caller retries.
+ */
+bool NTP::listen()
+{
+    if (!_udp.listen(NTP_PORT))
     {
         dlog.error(TAG, F("failed to listen on port %d!  Will retry in a bit..."), NTP_PORT);
-        delay(1000);
-        dlog.warning(TAG, F("setup: retrying!"));
+        return false;
     }
 
-    using namespace std::placeholders;  // for _1, _2, _3...
+    _udp.onPacket(onPacket, this);
+    return true;
+}
 
-    _udp.onPacket(std::bind( &NTP::ntp, this, _1));
+void NTP::onPacket(void* arg, hal::UDPPacket& packet)
+{
+    ((NTP*)arg)->ntp(packet);
 }
 
+/*
+ * Connectivity came back (maybe with a new address), start over
+ * with a fresh socket.
+ */
+bool NTP::rebind()
+{
+    dlog.info(TAG, F("rebinding port %d"), NTP_PORT);
+    _udp.close();
+    return listen();
+}
+
+/*
+ * Precision is the larger of the clock resolution (one CPU cycle) and
+ * the time it takes to read the clock, expressed as log2(seconds).
+ */
 int8_t NTP::computePrecision()
 {
     NTPTime t;
-    unsigned long start = micros();
+    uint32_t start = hal::cycles();
     for (int i = 0; i < PRECISION_COUNT; ++i)
     {
         getNTPTime(&t);
     }
-    unsigned long end   = micros();
-    double        total = (double)(end - start) / 1000000.0;
-    double        time  = total / PRECISION_COUNT;
-    double        prec  = log2(time);
-    dlog.info(TAG, F("computePrecision: total:%f time:%f prec:%f (%d)"), total, time, prec, (int8_t)prec);
+    uint32_t cycles = hal::cycles() - start;
+    double   time   = (double)MAX(cycles / PRECISION_COUNT, 1) / (double)CYCLES_PER_SEC;
+    double   prec   = log2(time);
+    dlog.info(TAG, F("computePrecision: cycles:%lu time:%.9f prec:%f (%d)"), cycles, time, prec, (int8_t)prec);
     return (int8_t)prec;
 }
 
+/*
+ * Build the constant part of the response once so that ntp() only has to
+ * fill in the three timestamps (and echo the poll).  Everything is kept in
+ * network byte order.
+ */
+void NTP::initTemplate()
+{
+    memset(&_template, 0, sizeof(_template));
+    _template.flags      = setLI(LI_NONE) | setVERS(NTP_VERSION) | setMODE(MODE_SERVER);
+    _template.stratum    = 1;
+    _template.precision  = _precision;
+    // TODO: compute actual root delay
+    _template.delay      = htonl(1);  //(uint32)(0.000001 * 65536.0);
+    memcpy(_template.ref_id, REF_ID, sizeof(_template.ref_id));
+    updateTemplate(_gps.getSeconds());
+}
+
+/*
+ * Called by GPS once per (real or, in holdover, synthesized) PPS edge.
+ * The reference time is the last real edge, in holdover the dispersion
+ * grows and once the holdover limit passes we report not synchronized.
+ */
+void NTP::updateTemplate(time_t seconds)
+{
+    if (_gps.isHoldoverExpired())
+    {
+        _template.flags   = setLI(LI_NOSYNC) | setVERS(NTP_VERSION) | setMODE(MODE_SERVER);
+        _template.stratum = STRATUM_NOSYNC;
+    }
+    else
+    {
+        _template.flags   = setLI(LI_NONE) | setVERS(NTP_VERSION) | setMODE(MODE_SERVER);
+        _template.stratum = 1;
+    }
+
+    _template.dispersion = htonl(_gps.getRootDispersion());
+
+    if (!_gps.isHoldover())
+    {
+        _template.ref_time.seconds  = htonl(toNTP(seconds));
+        _template.ref_time.fraction = 0;
+    }
+}
+
 void NTP::getNTPTime(NTPTime *time)
 {
-    struct timeval tv;
-    _gps.getTime(&tv);
-    time->seconds = toNTP(tv.tv_sec);
+    Timestamp ts;
+    _gps.getTime(&ts);
+    time->seconds  = TS_SECONDS(ts);
+    time->fraction = TS_FRACTION(ts);
+}
 
-    double percent = us2s(tv.tv_usec);
-    time->fraction = (uint32_t)(percent * (double)4294967296L);
+void NTP::getNTPTime(uint32_t cycles, NTPTime *time)
+{
+    Timestamp ts;
+    _gps.getTime(cycles, &ts);
+    time->seconds  = TS_SECONDS(ts);
+    time->fraction = TS_FRACTION(ts);
 }
 
-void NTP::ntp(AsyncUDPPacket& aup)
+void NTP::ntp(hal::UDPPacket& aup)
 {
+    uint32_t start = hal::cycles();
     ++_req_count;
-    NTPPacket ntp;
     NTPTime   recv_time;
-    getNTPTime(&recv_time);
+    getNTPTime(aup.rxCycles(), &recv_time);
+
+    //
+    // the access list goes first (after the receive time, which has to be
+    // the transport's stamp or taken as early as we can) so foreign traffic
+    // costs a lookup and nothing else, not even a log line about its length.
+    //
+    uint32_t     addr   = aup.remoteIP();
+    AccessAction access = _access.check(addr);
+    if (access == ACCESS_IGNORE || addr == 0)   // 0.0.0.0 is no client, and an empty slot in _clients
+    {
+        ++_ignore_count;
+        return;
+    }
+
     if (aup.length() != sizeof(NTPPacket))
     {
         dlog.warning(TAG, F("recievePacket: ignoring packet with bad length: %d < %d"), aup.length(), sizeof(NTPPacket));
         return;
     }
 
-    if (!_gps.isValid())
+    if (access == ACCESS_KOD)
     {
-        dlog.warning(TAG, F("recievePacket: GPS data not valid!"));
+        kod(aup, KOD_DENY);
         return;
     }
 
-    memcpy(&ntp, aup.data(), sizeof(ntp));
-    ntp.delay              = ntohl(ntp.delay);
-    ntp.dispersion         = ntohl(ntp.dispersion);
-    ntp.orig_time.seconds  = ntohl(ntp.orig_time.seconds);
-    ntp.orig_time.fraction = ntohl(ntp.orig_time.fraction);
-    ntp.ref_time.seconds   = ntohl(ntp.ref_time.seconds);
-    ntp.ref_time.fraction  = ntohl(ntp.ref_time.fraction);
-    ntp.recv_time.seconds  = ntohl(ntp.recv_time.seconds);
-    ntp.recv_time.fraction = ntohl(ntp.recv_time.fraction);
-    ntp.xmit_time.seconds  = ntohl(ntp.xmit_time.seconds);
-    ntp.xmit_time.fraction = ntohl(ntp.xmit_time.fraction);
-    dumpNTPPacket(&ntp);
+    //
+    // mode 6 lists client addresses in a reply bigger than the request,
+    // it is only for addresses the access list says may query
+    //
+    uint8_t flags   = aup.data()[0];
+    bool    control = getMODE(flags) == MODE_CONTROL;
+    if (control && access != ACCESS_QUERY)
+    {
+        ++_ignore_count;
+        return;
+    }
+
+    if (access != ACCESS_NOMONITOR)
+    {
+        uint32_t     now_ms = hal::millis();
+        ClientEntry& client = _clients.seen(addr, getMODE(flags), getVERS(flags), now_ms);
+        if (_rate_limit || control)
+        {
+            switch (_clients.limit(client, now_ms))
+            {
+                case CLIENT_ANSWER:
+                    break;
+                case CLIENT_KOD:
+                    if (!control)   // a query over its limit gets nothing at all
+                    {
+                        kod(aup, KOD_RATE);
+                        return;
+                    }
+                    ++_drop_count;
+                    return;
+                case CLIENT_DROP:
+                    ++_drop_count;
+                    return;
+            }
+        }
+    }
+
+    if (control)
+    {
+        this->control(aup);
+        return;
+    }
+
+    if (!_gps.isValid() && !_gps.isHoldover())
+    {
+        dlog.warning(TAG, F("recievePacket: GPS data not valid!"));
+        return;
+    }
 
     //
-    // Build the response
+    // Build the response over the request: its transmit time moves to our
+    // origin (as-is, so no byte swapping), the template covers everything
+    // before that but the poll, which echoes the client's, and our two
+    // timestamps go last.  The packet data may not be 32 bit aligned so
+    // only touch it with memcpy().
     //
-    ntp.flags      = setLI(LI_NONE) | setVERS(NTP_VERSION) | setMODE(MODE_SERVER);
-    ntp.stratum    = 1;
-    ntp.precision  = _precision;
-    // TODO: compute actual root delay, and root dispersion
-    ntp.delay = 1;      //(uint32)(0.000001 * 65536.0);
-    ntp.dispersion = 1; //(uint32_t)(_gps.getDispersion() * 65536.0); // TODO: pre-calculate this?
-    strncpy((char*)ntp.ref_id, REF_ID, sizeof(ntp.ref_id));
-    ntp.orig_time  = ntp.xmit_time;
-    ntp.recv_time  = recv_time;
-    getNTPTime(&(ntp.ref_time));
-    dumpNTPPacket(&ntp);
-    ntp.delay              = htonl(ntp.delay);
-    ntp.dispersion         = htonl(ntp.dispersion);
-    ntp.orig_time.seconds  = htonl(ntp.orig_time.seconds);
-    ntp.orig_time.fraction = htonl(ntp.orig_time.fraction);
-    ntp.ref_time.seconds   = htonl(ntp.ref_time.seconds);
-    ntp.ref_time.fraction  = htonl(ntp.ref_time.fraction);
-    ntp.recv_time.seconds  = htonl(ntp.recv_time.seconds);
-    ntp.recv_time.fraction = htonl(ntp.recv_time.fraction);
-    getNTPTime(&(ntp.xmit_time));
-    ntp.xmit_time.seconds  = htonl(ntp.xmit_time.seconds);
-    ntp.xmit_time.fraction = htonl(ntp.xmit_time.fraction);
-    aup.write((uint8_t*)&ntp, sizeof(ntp));
+    uint8_t* ntp  = aup.edit();
+    uint8_t  poll = ntp[offsetof(NTPPacket, poll)];
+    memcpy(ntp + offsetof(NTPPacket, orig_time), ntp + offsetof(NTPPacket, xmit_time), sizeof(NTPTime));
+    memcpy(ntp, &_template, offsetof(NTPPacket, orig_time));
+    ntp[offsetof(NTPPacket, poll)] = poll;
+    NTPTime time;
+    time.seconds  = htonl(recv_time.seconds);
+    time.fraction = htonl(recv_time.fraction);
+    memcpy(ntp + offsetof(NTPPacket, recv_time), &time, sizeof(time));
+    getNTPTime(&time);
+    time.seconds  = htonl(time.seconds);
+    time.fraction = htonl(time.fraction);
+    memcpy(ntp + offsetof(NTPPacket, xmit_time), &time, sizeof(time));
+    dumpNTPPacket((NTPPacket*)ntp);
+    aup.reply();
     ++_rsp_count;
+    if (_first_answer_ms == 0)
+    {
+        _first_answer_ms = hal::millis();
+    }
+
+    _cycles = hal::cycles() - start;
+    if (_cycles > _max_cycles)
+    {
+        _max_cycles = _cycles;
+    }
+}
+
+/*
+ * Tell a client that is asking too often to back off, or that is not
+ * welcome at all, (RFC 5905 7.4): stratum 0, the kiss code in the
+ * reference id and its transmit time as our origin so it can tell the
+ * reply is genuine.  The receive and transmit times are its own as well,
+ * they must not be used to set a clock.
+ */
+void NTP::kod(hal::UDPPacket& aup, const char* code)
+{
+    NTPPacket ntp;
+    memset(&ntp, 0, sizeof(ntp));
+    ntp.flags     = setLI(LI_NOSYNC) | setVERS(NTP_VERSION) | setMODE(MODE_SERVER);
+    ntp.stratum   = STRATUM_KOD;
+    ntp.poll      = aup.data()[offsetof(NTPPacket, poll)];
+    ntp.precision = _precision;
+    memcpy(ntp.ref_id, code, sizeof(ntp.ref_id));
+    memcpy(&ntp.orig_time, aup.data() + offsetof(NTPPacket, xmit_time), sizeof(ntp.orig_time));
+    ntp.recv_time = ntp.orig_time;
+    ntp.xmit_time = ntp.orig_time;
+    aup.write((uint8_t*)&ntp, sizeof(ntp));
+    ++_kod_count;
+}
+
+/*
+ * Answer a mode 6 MRU list request with one datagram of clients, newest
+ * first, starting at the index in the request's offset.  The reply is at
+ * most ten times the (padded) request so ntp() only lets addresses with a
+ * "query" access rule get here, always under the rate limit.
+ */
+void NTP::control(hal::UDPPacket& aup)
+{
+    NTPControl request;
+    memcpy(&request, aup.data(), sizeof(request));
+    if ((request.op & (NTP_CONTROL_RESPONSE | NTP_CONTROL_OP_MASK)) != NTP_CONTROL_READ_MRU)
+    {
+        dlog.debug(TAG, F("control: ignoring op 0x%02x"), request.op);
+        return;
+    }
+
+    uint8_t     buffer[sizeof(NTPControl) + NTP_CONTROL_MAX_DATA];
+    NTPControl* reply  = (NTPControl*)buffer;
+    uint32_t    now_ms = hal::millis();
+    uint32_t    index  = ntohs(request.offset);
+    uint32_t    count  = 0;
+    const ClientEntry* client = _clients.getNewest();
+    for (uint32_t i = 0; client != nullptr && i < index; ++i)
+    {
+        client = _clients.getOlder(*client);
+    }
+
+    for (; client != nullptr && (count + 1) * sizeof(NTPMRUEntry) <= NTP_CONTROL_MAX_DATA; client = _clients.getOlder(*client))
+    {
+        NTPMRUEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.addr     = client->addr;
+        entry.first    = htonl((now_ms - client->first_ms) / 1000);
+        entry.last     = htonl((now_ms - client->last_ms) / 1000);
+        entry.count    = htonl(client->requests);
+        entry.interval = htonl(ClientTable::getInterval(*client));
+        entry.kods     = htonl(client->kods);
+        entry.drops    = htonl(client->drops);
+        entry.mode     = client->mode;
+        entry.version  = client->version;
+        memcpy(buffer + sizeof(NTPControl) + count * sizeof(entry), &entry, sizeof(entry));
+        ++count;
+    }
+
+    memset(reply, 0, sizeof(*reply));
+    reply->flags    = setLI(LI_NONE) | setVERS(getVERS(request.flags)) | setMODE(MODE_CONTROL);
+    reply->op       = NTP_CONTROL_RESPONSE | NTP_CONTROL_READ_MRU | (client != nullptr ? NTP_CONTROL_MORE : 0);
+    reply->sequence = request.sequence;
+    reply->offset   = request.offset;
+    reply->count    = htons((uint16_t)(count * sizeof(NTPMRUEntry)));
+    aup.write(buffer, sizeof(NTPControl) + count * sizeof(NTPMRUEntry));
 }
@@ -22,9 +22,11 @@
 #ifndef NTP_H_
 #define NTP_H_
 
-#include "Arduino.h"
-#include "ESPAsyncUDP.h"
+#include "hal/HAL.h"
+#include "hal/UDPEndpoint.h"
 #include "GPS.h"
+#include "ClientTable.h"
+#include "AccessList.h"
 
 typedef struct ntp_time
 {
@@ -32,27 +34,111 @@ typedef struct ntp_time
     uint32_t fraction;
 } NTPTime;
 
+typedef struct ntp_packet
+{
+    uint8_t  flags;
+    uint8_t  stratum;
+    uint8_t  poll;
+    int8_t   precision;
+    uint32_t delay;
+    uint32_t dispersion;
+    uint8_t  ref_id[4];
+    NTPTime  ref_time;
+    NTPTime  orig_time;
+    NTPTime  recv_time;
+    NTPTime  xmit_time;
+} NTPPacket;
+
+//
+// Mode 6 (control) framing, RFC 1305 appendix B.  We only answer
+// NTP_CONTROL_READ_MRU: the request is padded to an NTPPacket and its
+// offset is the index (newest first) of the first client wanted.  The
+// reply carries as many NTPMRUEntry as fit from there, sets
+// NTP_CONTROL_MORE if there are others and count is the data length.
+//
+#define NTP_CONTROL_READ_MRU  10      // same opcode as ntpd's mrulist, not its format
+#define NTP_CONTROL_RESPONSE  0x80
+#define NTP_CONTROL_ERROR     0x40
+#define NTP_CONTROL_MORE      0x20
+#define NTP_CONTROL_OP_MASK   0x1f
+#define NTP_CONTROL_MAX_DATA  468     // per datagram, as ntpd
+
+typedef struct ntp_control
+{
+    uint8_t  flags;       // LI, version, mode 6
+    uint8_t  op;          // response, error and more bits and the opcode
+    uint16_t sequence;
+    uint16_t status;
+    uint16_t assoc_id;
+    uint16_t offset;
+    uint16_t count;       // bytes of data that follow
+} NTPControl;
+
+typedef struct ntp_mru_entry
+{
+    uint32_t addr;        // IPv4, as on the wire
+    uint32_t first;       // seconds since we first heard from it
+    uint32_t last;        // seconds since its latest request
+    uint32_t count;       // requests
+    uint32_t interval;    // average ms between requests
+    uint32_t kods;
+    uint32_t drops;
+    uint8_t  mode;        // of its latest request
+    uint8_t  version;
+    uint8_t  unused[2];
+} NTPMRUEntry;            // all in network byte order
+
 class NTP
 {
 public:
-    NTP(GPS& gps);
+    NTP(GPS& gps, hal::UDPEndpoint& udp);
     virtual ~NTP();
 
     void     begin();
+    bool     listen();
+    bool     rebind();
 
     uint32_t getReqCount() { return _req_count; }
     uint32_t getRspCount() { return _rsp_count; }
+    uint32_t getKoDCount()  { return _kod_count; }  // RATE and DENY Kiss-o'-Death replies
+    uint32_t getIgnoreCount() { return _ignore_count; } // requests the access list told us to ignore
+    uint32_t getDropCount() { return _drop_count; } // requests over the rate limit we did not answer
+    ClientTable& getClients() { return _clients; }
+    void     setRateLimit(bool enable) { _rate_limit = enable; }
+    bool     setAccess(const AccessRule* rules, unsigned count) { return _access.set(rules, count); }
+    uint32_t getCycles()    { return _cycles; }     // cycles spent in the last ntp() callback
+    uint32_t getMaxCycles() { return _max_cycles; } // worst case since the last resetCycles()
+    void     resetCycles()  { _max_cycles = 0; }
+    uint32_t getFirstAnswerMs() { return _first_answer_ms; } // millis() of our first response
 
 private:
+    friend class Benchmark;  // times the private hot paths
+
     GPS&     _gps;
-    AsyncUDP _udp;
+    hal::UDPEndpoint& _udp;
     uint32_t _req_count;
     uint32_t _rsp_count;
     uint8_t  _precision;
+    uint32_t _cycles;
+    uint32_t _max_cycles;
+    uint32_t _first_answer_ms;
+    uint32_t _kod_count;
+    uint32_t _drop_count;
+    uint32_t _ignore_count;
+    bool     _rate_limit;
+    AccessList  _access;
+    ClientTable _clients;
+    NTPPacket _template;    // pre-built response, all fields in network byte order
 
     void getNTPTime(NTPTime *time);
+    void getNTPTime(uint32_t cycles, NTPTime *time);
     int8_t computePrecision();
-    void ntp(AsyncUDPPacket& aup);
+    void initTemplate();
+    void updateTemplate(time_t seconds);
+    static void onPacket(void* arg, hal::UDPPacket& packet);
+    void ntp(hal::UDPPacket& aup);
+    void kod(hal::UDPPacket& aup, const char* code);
+    void control(hal::UDPPacket& aup);
 };
 
 #endif /* NTP_H_ */
@@ -0,0 +1,60 @@
+/*
+ * RTCCheckpoint.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 25, 2018
+ *      Author: chris.l
+ */
+
+#include "RTCCheckpoint.h"
+#include "hal/RTCMemory.h"
+
+#define CRC_OFFSET offsetof(RTCCheckpoint, crc)
+
+bool RTCCheckpointStore::load(RTCCheckpoint* cp)
+{
+    if (!hal::rtcRead(RTC_CHECKPOINT_OFFSET, (uint32_t*)cp, sizeof(RTCCheckpoint)))
+    {
+        return false;
+    }
+    return cp->magic == RTC_CHECKPOINT_MAGIC && cp->crc == crc32(cp, CRC_OFFSET);
+}
+
+void RTCCheckpointStore::save(RTCCheckpoint* cp)
+{
+    cp->magic = RTC_CHECKPOINT_MAGIC;
+    cp->crc   = crc32(cp, CRC_OFFSET);
+    hal::rtcWrite(RTC_CHECKPOINT_OFFSET, (uint32_t*)cp, sizeof(RTCCheckpoint));
+}
+
+/*
+ * Plain bitwise CRC-32 (IEEE), a few dozen bytes once a second does
+ * not justify a table.
+ */
+uint32_t RTCCheckpointStore::crc32(const void* data, size_t len)
+{
+    const uint8_t* p   = (const uint8_t*)data;
+    uint32_t       crc = 0xffffffff;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (int i = 0; i < 8; ++i)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,67 @@
+/*
+ * RTCCheckpoint.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 25, 2018
+ *      Author: chris.l
+ */
+
+#ifndef RTCCHECKPOINT_H_
+#define RTCCHECKPOINT_H_
+
+#include "hal/HAL.h"
+
+//
+// In 4 byte blocks of RTC user memory (128 of them).  Blocks 0-31 are
+// eboot's command area, an OTA update writes (then clears) it there, so
+// the checkpoint has to live past it to survive the OTA reboot.
+//
+#define RTC_CHECKPOINT_OFFSET 32
+#define RTC_CHECKPOINT_MAGIC  0x4e545031  // "NTP1", bump when the layout changes
+
+//
+// Timing state kept in RTC user memory, it survives ESP.reset(), restart
+// and watchdog resets but not a power cycle.  CCOUNT restarts at reset so
+// there is no edge timing in here, just what lets us resume quickly.
+//
+typedef struct rtc_checkpoint
+{
+    uint32_t magic;
+    uint32_t seconds;         // at the last PPS edge
+    int32_t  ppb;             // FLL frequency error
+    uint32_t valid_count;
+    uint32_t holdover_count;
+    uint32_t recovery_count;
+    uint32_t resume_count;
+    uint8_t  valid;
+    uint8_t  holdover;
+    uint8_t  reserved[2];
+    uint32_t crc;             // CRC32 of everything above
+} RTCCheckpoint;
+
+#if RTC_CHECKPOINT_OFFSET < 32
+#error "RTC_CHECKPOINT_OFFSET must be past eboot's command area (blocks 0-31)"
+#endif
+
+class RTCCheckpointStore
+{
+public:
+    static bool     load(RTCCheckpoint* cp);
+    static void     save(RTCCheckpoint* cp);
+    static uint32_t crc32(const void* data, size_t len);
+};
+
+#endif /* RTCCHECKPOINT_H_ */
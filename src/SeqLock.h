@@ -0,0 +1,92 @@
+/*
+ * SeqLock.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Jul 28, 2018
+ *      Author: chris.l
+ */
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include "hal/HAL.h"
+
+#if defined(ARDUINO)
+#define SEQLOCK_BARRIER() __asm__ __volatile__("" ::: "memory")   // one core, the compiler is all we have to stop
+#else
+#define SEQLOCK_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST) // host threads may run on other cores
+#endif
+
+//
+// Sequence lock for state shared with interrupt handlers.  Writers bump the
+// sequence to odd, update, and bump it back to even with interrupts masked so
+// a non-interrupt writer can't be torn by the ISR.  Readers never mask
+// interrupts, they copy the data and retry if the sequence changed under them.
+//
+template<typename T>
+class SeqLock
+{
+public:
+    SeqLock() : _seq(0), _retries(0), _ps(0), _data() {}
+
+    T& ICACHE_RAM_ATTR beginWrite()
+    {
+        _ps = hal::disableInterrupts();
+        ++_seq;
+        SEQLOCK_BARRIER();
+        return _data;
+    }
+
+    void ICACHE_RAM_ATTR endWrite()
+    {
+        SEQLOCK_BARRIER();
+        ++_seq;
+        hal::restoreInterrupts(_ps);
+    }
+
+    void read(T* out)
+    {
+        uint32_t seq;
+        for (;;)
+        {
+            seq = _seq;
+            SEQLOCK_BARRIER();
+            *out = _data;
+            SEQLOCK_BARRIER();
+            if ((seq & 1) == 0 && seq == _seq)
+            {
+                return;
+            }
+            ++_retries;
+        }
+    }
+
+    //
+    // Only for writers (or interrupt context) where no write can be in
+    // progress, everyone else has to read() even for a single field.
+    //
+    const T& peek() { return _data; }
+
+    uint32_t getRetries() { return _retries; }
+
+private:
+    volatile uint32_t _seq;
+    volatile uint32_t _retries;
+    uint32_t          _ps;
+    T                 _data;
+};
+
+#endif /* SEQLOCK_H_ */
@@ -0,0 +1,88 @@
+/*
+ * Timestamp.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Jul 14, 2018
+ *      Author: chris.l
+ */
+
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+
+#include <stdint.h>
+
+//
+// 64 bit NTP format timestamp: upper 32 bits are seconds since 1900,
+// lower 32 bits are the binary fraction of a second.  All conversions
+// use integer multiply and shift only, we have no FPU.
+//
+typedef uint64_t Timestamp;
+
+#define MICROS_PER_SEC  1000000
+#define CYCLES_PER_SEC  ((uint32_t)F_CPU)          // CCOUNT ticks per second (6.25ns @ 160MHz)
+#define CYCLES_PER_US   (CYCLES_PER_SEC/MICROS_PER_SEC)
+
+#define SEVENTY_YEARS   2208988800UL
+#define toEPOCH(t)      ((uint32_t)(t)-SEVENTY_YEARS)
+#define toNTP(t)        ((uint32_t)(t)+SEVENTY_YEARS)
+
+#define TS_SECONDS(ts)  ((uint32_t)((ts) >> 32))
+#define TS_FRACTION(ts) ((uint32_t)(ts))
+#define TS_MAKE(s, f)   (((Timestamp)(uint32_t)(s) << 32) | (uint32_t)(f))
+
+#define US2FRAC_MULT    9223372036855ULL // ceil(2^63 / 10^6)
+
+//
+// microseconds (0-999999) to NTP fraction, within 1 LSB of the exact value
+// so that frac2us(us2frac(us)) == us for every microsecond.
+//
+static inline uint32_t us2frac(uint32_t us)
+{
+    return (uint32_t)((us * US2FRAC_MULT) >> 31);
+}
+
+//
+// NTP fraction to microseconds, rounded to nearest.
+//
+static inline uint32_t frac2us(uint32_t frac)
+{
+    uint32_t us = (uint32_t)(((uint64_t)frac * MICROS_PER_SEC + 0x80000000UL) >> 32);
+    return us < MICROS_PER_SEC ? us : MICROS_PER_SEC-1;
+}
+
+#define PS2FRAC_MULT    4611686LL // round(2^62 / 10^12)
+
+//
+// signed picoseconds (well under a second) to NTP fraction
+//
+static inline int32_t ps2frac(int32_t ps)
+{
+    return (int32_t)(((int64_t)ps * PS2FRAC_MULT) >> 30);
+}
+
+//
+// CPU cycles since a PPS edge to NTP fraction.  'scale' is 2^56 / cycles
+// per second (see FRAC_SCALE()), cycles must be less than 2^28.
+//
+#define FRAC_SCALE_SHIFT 24
+#define FRAC_SCALE(cycles_per_sec) ((uint32_t)((1ULL << (32+FRAC_SCALE_SHIFT)) / (cycles_per_sec)))
+
+static inline uint32_t cycles2frac(uint32_t cycles, uint32_t scale)
+{
+    return (uint32_t)(((uint64_t)cycles * scale) >> FRAC_SCALE_SHIFT);
+}
+
+#endif /* TIMESTAMP_H_ */
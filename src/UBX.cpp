@@ -0,0 +1,201 @@
+/*
+ * UBX.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 18, 2018
+ *      Author: chris.l
+ */
+
+#include <string.h>
+#include "UBX.h"
+#include "NMEAParser.h"
+
+#define NAV_TIMEUTC_LEN       20
+#define NAV_TIMEUTC_VALID_UTC 0x04
+#define TIM_TP_LEN            16
+#define TIM_TP_QERR_INVALID   0x10
+#define NANOS_PER_HALF_SEC    500000000L
+
+//
+// UBX is little endian
+//
+static inline uint16_t u2(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t u4(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+UBX::UBX() :
+    _state(SYNC1),
+    _class(0),
+    _id(0),
+    _length(0),
+    _count(0),
+    _ck_a(0),
+    _ck_b(0),
+    _frames(0),
+    _errors(0)
+{
+}
+
+UBX::~UBX()
+{
+}
+
+bool UBX::process(uint8_t c)
+{
+    switch (_state)
+    {
+    case SYNC1:
+        if (c == UBX_SYNC1)
+        {
+            _state = SYNC2;
+        }
+        break;
+
+    case SYNC2:
+        _state = c == UBX_SYNC2 ? CLASS : SYNC1;
+        _ck_a  = 0;
+        _ck_b  = 0;
+        break;
+
+    case CLASS:
+        _class = c;
+        checksum(c);
+        _state = ID;
+        break;
+
+    case ID:
+        _id = c;
+        checksum(c);
+        _state = LENGTH1;
+        break;
+
+    case LENGTH1:
+        _length = c;
+        checksum(c);
+        _state = LENGTH2;
+        break;
+
+    case LENGTH2:
+        _length |= (uint16_t)c << 8;
+        checksum(c);
+        _count = 0;
+        _state = _length ? PAYLOAD : CK_A;
+        break;
+
+    case PAYLOAD:
+        if (_count < UBX_MAX_PAYLOAD)
+        {
+            _payload[_count] = c;
+        }
+        checksum(c);
+        if (++_count >= _length)
+        {
+            _state = CK_A;
+        }
+        break;
+
+    case CK_A:
+        if (c != _ck_a)
+        {
+            ++_errors;
+            _state = SYNC1;
+            break;
+        }
+        _state = CK_B;
+        break;
+
+    case CK_B:
+        _state = SYNC1;
+        if (c != _ck_b)
+        {
+            ++_errors;
+            break;
+        }
+        ++_frames;
+        return _length <= UBX_MAX_PAYLOAD;
+    }
+    return false;
+}
+
+bool UBX::getTimeUTC(time_t* time)
+{
+    if (!is(UBX_CLASS_NAV, UBX_NAV_TIMEUTC) || _length != NAV_TIMEUTC_LEN
+            || (_payload[19] & NAV_TIMEUTC_VALID_UTC) == 0)
+    {
+        return false;
+    }
+
+    int32_t nano = (int32_t)u4(_payload+8);
+    *time = (time_t)NMEAParser::daysFromCivil(u2(_payload+12), _payload[14], _payload[15]) * 86400
+            + _payload[16] * 3600 + _payload[17] * 60 + _payload[18];
+
+    //
+    // the epoch is within a few ms of the second, 'nano' says which side
+    //
+    if (nano >= NANOS_PER_HALF_SEC)
+    {
+        *time += 1;
+    }
+    else if (nano < -NANOS_PER_HALF_SEC)
+    {
+        *time -= 1;
+    }
+    return true;
+}
+
+bool UBX::getQuantizationError(int32_t* qerr)
+{
+    if (!is(UBX_CLASS_TIM, UBX_TIM_TP) || _length != TIM_TP_LEN || (_payload[14] & TIM_TP_QERR_INVALID))
+    {
+        return false;
+    }
+    *qerr = (int32_t)u4(_payload+8);
+    return true;
+}
+
+/*
+ * Build a frame in 'buffer' (len + UBX_OVERHEAD bytes), returns its length.
+ */
+size_t UBX::frame(uint8_t* buffer, uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len)
+{
+    buffer[0] = UBX_SYNC1;
+    buffer[1] = UBX_SYNC2;
+    buffer[2] = cls;
+    buffer[3] = id;
+    buffer[4] = (uint8_t)len;
+    buffer[5] = (uint8_t)(len >> 8);
+    if (len)
+    {
+        memcpy(buffer+6, payload, len);
+    }
+
+    uint8_t ck_a = 0;
+    uint8_t ck_b = 0;
+    for (size_t i = 2; i < (size_t)len + 6; ++i)
+    {
+        ck_a += buffer[i];
+        ck_b += ck_a;
+    }
+    buffer[len+6] = ck_a;
+    buffer[len+7] = ck_b;
+    return len + UBX_OVERHEAD;
+}
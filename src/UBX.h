@@ -0,0 +1,117 @@
+/*
+ * UBX.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Aug 18, 2018
+ *      Author: chris.l
+ */
+
+#ifndef UBX_H_
+#define UBX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#define UBX_SYNC1          0xb5
+#define UBX_SYNC2          0x62
+#define UBX_OVERHEAD       8    // sync, class, id, length and checksum
+#define UBX_MAX_PAYLOAD    40   // larger frames are checked but not kept
+
+#define UBX_CLASS_NAV      0x01
+#define UBX_CLASS_ACK      0x05
+#define UBX_CLASS_CFG      0x06
+#define UBX_CLASS_TIM      0x0d
+#define UBX_CLASS_NMEA     0xf0
+
+#define UBX_NAV_TIMEUTC    0x21
+#define UBX_ACK_NAK        0x00
+#define UBX_ACK_ACK        0x01
+#define UBX_CFG_PRT        0x00
+#define UBX_CFG_MSG        0x01
+#define UBX_TIM_TP         0x01
+
+#define UBX_NMEA_GGA       0x00
+#define UBX_NMEA_GLL       0x01
+#define UBX_NMEA_GSA       0x02
+#define UBX_NMEA_GSV       0x03
+#define UBX_NMEA_RMC       0x04
+#define UBX_NMEA_VTG       0x05
+#define UBX_NMEA_ZDA       0x08
+
+//
+// Streaming decoder for the u-blox UBX binary protocol.  Frames are checked
+// (Fletcher checksum) as the bytes arrive, only the timing messages we use
+// are decoded.
+//
+class UBX
+{
+public:
+    UBX();
+    virtual ~UBX();
+
+    bool           process(uint8_t c);  // true when a frame with a good checksum is complete
+    bool           inFrame()      { return _state != SYNC1; }
+
+    uint8_t        getClass()     { return _class; }
+    uint8_t        getID()        { return _id; }
+    uint16_t       getLength()    { return _length; }
+    const uint8_t* getPayload()   { return _payload; }
+    bool           is(uint8_t cls, uint8_t id) { return _class == cls && _id == id; }
+    uint32_t       getFrames()    { return _frames; }
+    uint32_t       getErrors()    { return _errors; }
+
+    //
+    // NAV-TIMEUTC: UTC of the navigation epoch, rounded to the second
+    //
+    bool           getTimeUTC(time_t* time);
+
+    //
+    // TIM-TP: quantization error (ps) of the next time pulse
+    //
+    bool           getQuantizationError(int32_t* qerr);
+
+    static size_t  frame(uint8_t* buffer, uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len);
+
+private:
+    typedef enum
+    {
+        SYNC1,
+        SYNC2,
+        CLASS,
+        ID,
+        LENGTH1,
+        LENGTH2,
+        PAYLOAD,
+        CK_A,
+        CK_B
+    } State;
+
+    State    _state;
+    uint8_t  _class;
+    uint8_t  _id;
+    uint16_t _length;
+    uint16_t _count;
+    uint8_t  _ck_a;
+    uint8_t  _ck_b;
+    uint8_t  _payload[UBX_MAX_PAYLOAD];
+    uint32_t _frames;
+    uint32_t _errors;
+
+    void     checksum(uint8_t c) { _ck_a += c; _ck_b += _ck_a; }
+};
+
+#endif /* UBX_H_ */
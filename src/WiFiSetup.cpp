@@ -33,7 +33,14 @@ WiFiSetup::WiFiSetup(Config& config, Display& display, Stream& serial, boolean d
   _ota_fp("ota_fp",   "OTA Fingerprint", "", 64),
   _syslog_host("syslog_host", "Syslog Host", "", 64),
   _syslog_port("syslog_port", "Syslog Port", "514", 8),
-  _devicename(devicename)
+  _devicename(devicename),
+  _connect_start(0),
+  _retry_ms(WIFI_RETRY_MIN_MS),
+  _connected(false),
+  _outage_start(0),
+  _outages(0),
+  _longest_outage_ms(0),
+  _total_outage_ms(0)
 {
     _wm.setDebugOutput(debug);
 
@@ -46,28 +53,103 @@ WiFiSetup::~WiFiSetup()
 {
 }
 
-void WiFiSetup::connect(bool force_config)
+/*
+ * Start connecting with the saved credentials, process() reports when we
+ * are connected.  Only the (forced) config portal blocks.
+ */
+void WiFiSetup::begin(bool force_config)
 {
     WiFi.mode(WiFiMode::WIFI_STA);
     WiFi.setSleepMode(WIFI_NONE_SLEEP);
 
-    dlog.info(TAG, F("connect: disableing captive portal when auto-connecting"));
+    dlog.info(TAG, F("begin: disableing captive portal when auto-connecting"));
     _wm.setEnableConfigPortal(false); // don't automatically use the captive portal
 
     if (force_config)
     {
-        dlog.info(TAG, F("connect: starting forced config portal!"));
+        dlog.info(TAG, F("begin: starting forced config portal!"));
         _wm.startConfigPortal(_devicename, NULL);
     }
-    else
+
+    start();
+}
+
+void WiFiSetup::start()
+{
+    _connect_start = millis();
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        return;
+    }
+    dlog.info(TAG, F("start: connecting"));
+    WiFi.begin();
+}
+
+/*
+ * Call from loop(), returns true while we have an IP address.  When it
+ * is lost we reconnect in place with an exponential backoff and keep
+ * track of how long we were off the network.
+ */
+bool WiFiSetup::process()
+{
+    if (WiFi.status() == WL_CONNECTED && WiFi.localIP() != IPAddress(0,0,0,0))
     {
-        dlog.info(TAG, F("connect: auto-connecting"));
-        while (!_wm.autoConnect(_devicename, NULL))
+        if (!_connected)
         {
-            dlog.error(TAG, F("connect: not connected! retrying...."));
-            delay(1000);
+            _connected = true;
+            _retry_ms  = WIFI_RETRY_MIN_MS;
+            if (_outage_start != 0)
+            {
+                uint32_t outage     = millis() - _outage_start;
+                _outage_start       = 0;
+                _total_outage_ms   += outage;
+                _longest_outage_ms  = outage > _longest_outage_ms ? outage : _longest_outage_ms;
+                dlog.warning(TAG, F("process: reconnected after %lu ms (outages:%lu longest:%lu ms)"),
+                        outage, _outages, _longest_outage_ms);
+            }
         }
+        return true;
     }
+
+    if (_connected)
+    {
+        _connected    = false;
+        _outage_start = millis();
+        ++_outages;
+        dlog.error(TAG, F("process: lost connectivity, reconnecting"));
+        start();
+        return false;
+    }
+
+    if (millis() - _connect_start > _retry_ms)
+    {
+        dlog.error(TAG, F("process: not connected after %lu ms! retrying...."), _retry_ms);
+        _retry_ms = _retry_ms * 2 < WIFI_RETRY_MAX_MS ? _retry_ms * 2 : WIFI_RETRY_MAX_MS;
+        _connect_start = millis();
+        // not WiFi.disconnect(), with persistence on it erases the saved credentials
+        WiFi.reconnect();
+    }
+    return false;
+}
+
+/*
+ * Blocks in the config portal for up to WIFI_PORTAL_TIMEOUT seconds, for
+ * when the saved network can't be joined at boot.  Returns true if we
+ * were given one that works.
+ */
+bool WiFiSetup::portal()
+{
+    dlog.info(TAG, F("portal: starting config portal for %u seconds"), WIFI_PORTAL_TIMEOUT);
+    _wm.setConfigPortalTimeout(WIFI_PORTAL_TIMEOUT);
+    bool connected = _wm.startConfigPortal(_devicename, NULL);
+    _retry_ms = WIFI_RETRY_MIN_MS;
+    start();
+    return connected;
+}
+
+uint32_t WiFiSetup::getOutageMs()
+{
+    return _outage_start != 0 ? millis() - _outage_start : 0;
 }
 
 void WiFiSetup::startingPortal(WiFiManager* wmp)
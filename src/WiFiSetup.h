@@ -27,11 +27,21 @@
 #include "Display.h"
 #include "Config.h"
 
+#define WIFI_RETRY_MIN_MS 10000  // first retry of a connection attempt after this long
+#define WIFI_RETRY_MAX_MS 120000 // retries back off (doubling) up to this
+#define WIFI_PORTAL_TIMEOUT 300  // seconds the boot fallback portal waits for someone
+
 class WiFiSetup {
 public:
 	WiFiSetup(Config& config, Display& display, Stream& serial, boolean debug, const char* devicename);
 	virtual ~WiFiSetup();
-	void connect(bool force_config = false);
+	void begin(bool force_config = false);
+	bool process();
+	bool portal();
+	uint32_t getOutages()          { return _outages; }
+	uint32_t getOutageMs();        // current outage, 0 if connected
+	uint32_t getLongestOutageMs()  { return _longest_outage_ms; }
+	uint32_t getTotalOutageMs()    { return _total_outage_ms; }
 	const char* getOTAURL();
 	const char* getOTAFP();
 	const char* getSyslogHost();
@@ -45,6 +55,14 @@ private:
     WiFiManagerParameter _syslog_host;
     WiFiManagerParameter _syslog_port;
 	const char*          _devicename;
+	uint32_t             _connect_start;
+	uint32_t             _retry_ms;          // current backoff
+	bool                 _connected;
+	uint32_t             _outage_start;      // millis() when we lost the IP, 0 if connected
+	uint32_t             _outages;
+	uint32_t             _longest_outage_ms;
+	uint32_t             _total_outage_ms;
+	void start();
 	void startingPortal(WiFiManager* wmp);
 	void saveConfig();
 	const char*getParam(WiFiManagerParameter& param);
@@ -0,0 +1,49 @@
+/*
+ * FileSystem.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef FILESYSTEM_H_
+#define FILESYSTEM_H_
+
+#include "HAL.h"
+
+namespace hal
+{
+
+//
+// Just enough of a file system for small whole-file reads and writes
+// (config and drift files).
+//
+class FileSystem
+{
+public:
+    virtual ~FileSystem() {}
+
+    virtual bool begin() = 0;   // mount
+    virtual bool format() = 0;
+    virtual bool exists(const char* path) = 0;
+    virtual int  read(const char* path, char* buffer, size_t size) = 0; // bytes read, -1 on error
+    virtual bool write(const char* path, const char* data, size_t len) = 0;
+    virtual void list(std::function<void(const char* name, size_t size)> callback) = 0;
+};
+
+}
+
+#endif /* FILESYSTEM_H_ */
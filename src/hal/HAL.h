@@ -0,0 +1,105 @@
+/*
+ * HAL.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+//
+// Hardware abstraction: the timing and protocol code (GPS, NTP, Config...)
+// includes this instead of Arduino.h so it also builds on a POSIX host
+// (see the 'native' env in platformio.ini).  The clock and interrupt
+// masking are plain inline functions, they are on the PPS interrupt and
+// NTP hot paths and must cost no more than the calls they replace.  The
+// rest (pins, timers, serial, UDP, files) are small interfaces with an
+// implementation in hal/esp8266 and one in hal/posix.
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+
+#if defined(ARDUINO)
+
+#include "Arduino.h"
+#include <lwip/def.h> // htonl() & ntohl()
+
+namespace hal
+{
+inline uint32_t cycles()             { return ESP.getCycleCount(); } // CCOUNT
+inline uint32_t millis()             { return ::millis(); }
+inline void     delay(uint32_t ms)   { ::delay(ms); }
+inline void     yield()              { ::yield(); }
+inline uint32_t disableInterrupts()  { return xt_rsil(15); }
+inline void     restoreInterrupts(uint32_t state) { xt_wsr_ps(state); }
+}
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h> // htonl() & ntohl()
+
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define F(s)            (s)
+#define FPSTR(s)        (s)
+#define memcpy_P        memcpy
+#define strlen_P        strlen
+
+//
+// not in glibc before 2.38
+//
+static inline size_t hal_strlcpy(char* dst, const char* src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size)
+    {
+        size_t n = len < size-1 ? len : size-1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#define strlcpy         hal_strlcpy
+
+namespace hal
+{
+//
+// Emulated CCOUNT: a 32 bit counter at F_CPU, from CLOCK_MONOTONIC or
+// from simulated time (see hal/posix/PosixClock.h).
+//
+uint32_t cycles();
+uint32_t millis();
+void     delay(uint32_t ms);
+void     yield();
+
+//
+// There are no real interrupts on the host, "interrupt handlers" are
+// called from the same thread so masking is a no-op.
+//
+inline uint32_t disableInterrupts()  { return 0; }
+inline void     restoreInterrupts(uint32_t state) { (void)state; }
+}
+
+#endif
+
+#endif /* HAL_H_ */
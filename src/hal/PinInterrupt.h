@@ -0,0 +1,45 @@
+/*
+ * PinInterrupt.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef PININTERRUPT_H_
+#define PININTERRUPT_H_
+
+#include "HAL.h"
+
+namespace hal
+{
+
+//
+// Rising edge interrupt on an input pin (the PPS).  The handler runs in
+// interrupt context on the device.
+//
+class PinInterrupt
+{
+public:
+    virtual ~PinInterrupt() {}
+
+    virtual void attach(std::function<void()> handler) = 0;
+    virtual void detach() = 0;
+};
+
+}
+
+#endif /* PININTERRUPT_H_ */
@@ -0,0 +1,58 @@
+/*
+ * SerialPort.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef SERIALPORT_H_
+#define SERIALPORT_H_
+
+#include "HAL.h"
+
+namespace hal
+{
+
+//
+// Receive side of the GPS UART.  Besides the bytes it keeps the CPU cycle
+// count at which each '$' (NMEA) and 0xb5 (UBX sync) arrived, looked up by
+// stream index.
+//
+class SerialPort
+{
+public:
+    virtual ~SerialPort() {}
+
+    virtual int      available() = 0;
+    virtual int      read() = 0;
+    virtual size_t   read(char* buffer, size_t size) = 0;
+    virtual size_t   write(const uint8_t* data, size_t len) = 0;
+    virtual void     flush() = 0;
+    virtual void     setBaud(uint32_t baud) = 0;
+    virtual uint32_t getBaud() = 0;
+
+    virtual uint32_t getReadIndex() = 0;  // stream index of the next byte read()
+    virtual bool     getStamp(uint32_t index, uint32_t* cycles) = 0;
+
+    virtual uint32_t getOverflows() = 0;       // ring full, byte dropped
+    virtual uint32_t getFIFOOverflows() = 0;   // hardware FIFO overrun
+    virtual uint32_t getStampOverflows() = 0;  // timestamps dropped
+};
+
+}
+
+#endif /* SERIALPORT_H_ */
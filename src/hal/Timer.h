@@ -0,0 +1,46 @@
+/*
+ * Timer.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include "HAL.h"
+
+namespace hal
+{
+
+//
+// One shot timer, start() re-arms it (also from within the callback).
+// The callback runs in interrupt context on the device.
+//
+class Timer
+{
+public:
+    virtual ~Timer() {}
+
+    virtual void setCallback(std::function<void()> callback) = 0;
+    virtual void start(uint32_t ms) = 0;
+    virtual void stop() = 0;
+};
+
+}
+
+#endif /* TIMER_H_ */
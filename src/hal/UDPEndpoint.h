@@ -0,0 +1,73 @@
+/*
+ * UDPEndpoint.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef UDPENDPOINT_H_
+#define UDPENDPOINT_H_
+
+#include "HAL.h"
+
+namespace hal
+{
+
+//
+// A received datagram, write() sends a reply to its source.  Only valid
+// during the onPacket() callback.
+//
+// A reply the same size as the request can instead be built over the
+// request in edit() (the same bytes as data()) and sent with reply(),
+// which saves copying it and, where the transport allows, allocating a
+// buffer for it.  PosixUDPEndpoint and ESPRawUDPEndpoint do not allocate,
+// ESPUDPEndpoint (the default firmware) still allocates and copies a pbuf
+// per reply because ESPAsyncUDP does not hand out the received one.
+//
+class UDPPacket
+{
+public:
+    virtual ~UDPPacket() {}
+
+    virtual size_t         length() = 0;
+    virtual const uint8_t* data() = 0;
+    virtual size_t         write(const uint8_t* data, size_t len) = 0;
+    virtual uint8_t*       edit() = 0;
+    virtual size_t         reply() = 0;     // send length() bytes of edit() back
+    virtual uint32_t       remoteIP() = 0;  // IPv4 source address in network byte order
+    virtual uint32_t       rxCycles() = 0;  // cycles() when it reached us, as early as the transport can tell
+};
+
+//
+// The handler is a plain function and its argument rather than a
+// std::function, it is called for every request before anything else.
+//
+typedef void (*UDPHandler)(void* arg, UDPPacket& packet);
+
+class UDPEndpoint
+{
+public:
+    virtual ~UDPEndpoint() {}
+
+    virtual bool listen(uint16_t port) = 0;
+    virtual void close() = 0;
+    virtual void onPacket(UDPHandler handler, void* arg) = 0;
+};
+
+}
+
+#endif /* UDPENDPOINT_H_ */
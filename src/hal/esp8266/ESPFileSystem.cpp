@@ -0,0 +1,85 @@
+/*
+ * ESPFileSystem.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "ESPFileSystem.h"
+#include "FS.h"
+
+namespace hal
+{
+
+ESPFileSystem::ESPFileSystem()
+{
+}
+
+ESPFileSystem::~ESPFileSystem()
+{
+}
+
+bool ESPFileSystem::begin()
+{
+    return SPIFFS.begin();
+}
+
+bool ESPFileSystem::format()
+{
+    return SPIFFS.format();
+}
+
+bool ESPFileSystem::exists(const char* path)
+{
+    return SPIFFS.exists(path);
+}
+
+int ESPFileSystem::read(const char* path, char* buffer, size_t size)
+{
+    File f = SPIFFS.open(path, "r");
+    if (!f)
+    {
+        return -1;
+    }
+    int len = f.read((uint8_t*)buffer, size);
+    f.close();
+    return len;
+}
+
+bool ESPFileSystem::write(const char* path, const char* data, size_t len)
+{
+    File f = SPIFFS.open(path, "w");
+    if (!f)
+    {
+        return false;
+    }
+    size_t written = f.write((const uint8_t*)data, len);
+    f.close();
+    return written == len;
+}
+
+void ESPFileSystem::list(std::function<void(const char* name, size_t size)> callback)
+{
+    Dir dir = SPIFFS.openDir("");
+    while (dir.next())
+    {
+        File f = dir.openFile("r");
+        callback(dir.fileName().c_str(), f.size());
+    }
+}
+
+}
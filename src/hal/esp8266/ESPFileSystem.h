@@ -0,0 +1,46 @@
+/*
+ * ESPFileSystem.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ESPFILESYSTEM_H_
+#define ESPFILESYSTEM_H_
+
+#include "hal/FileSystem.h"
+
+namespace hal
+{
+
+class ESPFileSystem : public FileSystem
+{
+public:
+    ESPFileSystem();
+    virtual ~ESPFileSystem();
+
+    bool begin() override;
+    bool format() override;
+    bool exists(const char* path) override;
+    int  read(const char* path, char* buffer, size_t size) override;
+    bool write(const char* path, const char* data, size_t len) override;
+    void list(std::function<void(const char* name, size_t size)> callback) override;
+};
+
+}
+
+#endif /* ESPFILESYSTEM_H_ */
@@ -0,0 +1,185 @@
+/*
+ * ESPLinkStamp.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 18, 2018
+ *      Author: chris.l
+ */
+
+#include "ESPLinkStamp.h"
+#include "Timestamp.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+namespace hal
+{
+
+typedef struct link_frame
+{
+    const uint8_t* start;   // the frame's bytes in its first pbuf
+    const uint8_t* end;
+    uint32_t       cycles;  // when the driver handed it over
+} LinkFrame;
+
+typedef struct link_netif
+{
+    struct netif*  netif;
+    netif_input_fn input;   // what we call on to
+} LinkNetif;
+
+static LinkFrame frames[LINK_STAMP_ENTRIES];
+static uint32_t  next_frame;    // also the count of frames stamped
+static LinkNetif netifs[LINK_STAMP_NETIFS];
+
+uint32_t ESPLinkStamp::_unhooked;
+uint32_t ESPLinkStamp::_hits;
+uint32_t ESPLinkStamp::_misses;
+uint32_t ESPLinkStamp::_bins[LINK_STAMP_BINS];
+
+static err_t stampInput(struct pbuf* p, struct netif* netif)
+{
+    uint32_t   cycles = hal::cycles();
+    LinkFrame& frame  = frames[next_frame++ & (LINK_STAMP_ENTRIES-1)];
+    frame.start  = (const uint8_t*)p->payload;
+    frame.end    = frame.start + p->len;
+    frame.cycles = cycles;
+
+    for (unsigned i = 0; i < LINK_STAMP_NETIFS; ++i)
+    {
+        if (netifs[i].netif == netif)
+        {
+            return netifs[i].input(p, netif);
+        }
+    }
+    pbuf_free(p);   // can't happen, we only hook what we have a slot for
+    return ERR_OK;
+}
+
+static bool listed(struct netif* netif)
+{
+    for (struct netif* n = netif_list; n != nullptr; n = n->next)
+    {
+        if (n == netif)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Hook any netif we have not hooked yet, safe to call again after the
+ * WiFi comes back (maybe as a new netif).  Slots of netifs that are gone
+ * are freed first, a netif that was re-added (its input reset) gets its
+ * old slot back so stampInput() never finds a stale input function.
+ */
+void ESPLinkStamp::install()
+{
+    for (unsigned i = 0; i < LINK_STAMP_NETIFS; ++i)
+    {
+        if (netifs[i].netif != nullptr && !listed(netifs[i].netif))
+        {
+            netifs[i].netif = nullptr;
+            netifs[i].input = nullptr;
+        }
+    }
+
+    for (struct netif* netif = netif_list; netif != nullptr; netif = netif->next)
+    {
+        if (netif->input == stampInput || netif->input == nullptr)
+        {
+            continue;
+        }
+
+        LinkNetif* slot = nullptr;
+        for (unsigned i = 0; i < LINK_STAMP_NETIFS && slot == nullptr; ++i)
+        {
+            if (netifs[i].netif == netif)
+            {
+                slot = &netifs[i];
+            }
+        }
+        for (unsigned i = 0; i < LINK_STAMP_NETIFS && slot == nullptr; ++i)
+        {
+            if (netifs[i].netif == nullptr)
+            {
+                slot = &netifs[i];
+            }
+        }
+        if (slot == nullptr)
+        {
+            ++_unhooked;
+            continue;
+        }
+
+        slot->netif  = netif;
+        slot->input  = netif->input;
+        netif->input = stampInput;
+    }
+}
+
+uint32_t ESPLinkStamp::getFrames()
+{
+    return next_frame;
+}
+
+uint32_t ESPLinkStamp::earliest(const void* data, uint32_t cycles)
+{
+    uint32_t link;
+    if (!find(data, &link))
+    {
+        return cycles;
+    }
+    noteSaved(cycles - link);
+    return link;
+}
+
+/*
+ * The stamp of the frame that holds 'data', newest first.
+ */
+bool ESPLinkStamp::find(const void* data, uint32_t* cycles)
+{
+    uint32_t now = hal::cycles();
+    for (uint32_t i = 1; i <= LINK_STAMP_ENTRIES; ++i)
+    {
+        const LinkFrame& frame = frames[(next_frame - i) & (LINK_STAMP_ENTRIES-1)];
+        if (frame.start <= (const uint8_t*)data && (const uint8_t*)data < frame.end
+                && now - frame.cycles < LINK_STAMP_MAX_US * CYCLES_PER_US)
+        {
+            *cycles = frame.cycles;
+            ++_hits;
+            return true;
+        }
+    }
+    ++_misses;
+    return false;
+}
+
+/*
+ * Count how much earlier than the transport's own stamp the link one was.
+ */
+void ESPLinkStamp::noteSaved(uint32_t cycles)
+{
+    uint32_t us  = cycles / CYCLES_PER_US;
+    unsigned bin = 0;
+    while (bin < LINK_STAMP_BINS-1 && us >= (1UL << bin))
+    {
+        ++bin;
+    }
+    ++_bins[bin];
+}
+
+}
@@ -0,0 +1,73 @@
+/*
+ * ESPLinkStamp.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 18, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ESPLINKSTAMP_H_
+#define ESPLINKSTAMP_H_
+
+#include "hal/HAL.h"
+
+#define LINK_STAMP_ENTRIES  4     // frames remembered, a power of 2
+#define LINK_STAMP_NETIFS   2     // station and soft AP
+#define LINK_STAMP_MAX_US   50000 // older than this is some other frame
+#define LINK_STAMP_BINS     10    // saved time histogram: <1us, <2us ... <256us, and more
+
+namespace hal
+{
+
+//
+// Stamps every frame as the WiFi driver hands it to lwIP, built in with
+// -DNTP_LINK_STAMP.  install() puts a wrapper in front of each netif's
+// input function that notes cycles() and where the frame's bytes are
+// before passing it on.  lwIP takes a frame up to the UDP callback within
+// that same call, so earliest() can find the stamp of the datagram an
+// endpoint was just given from its data pointer.
+//
+// The histogram counts how much earlier the link stamp was, the time in
+// lwIP (and AsyncUDP) it takes out of each request's receive time.  If the
+// WiFi glue hands frames to ethernet_input() without going through
+// netif->input no frames are counted and every lookup misses, the
+// requests then keep the transport's stamp.
+//
+class ESPLinkStamp
+{
+public:
+    static void     install();
+    static uint32_t earliest(const void* data, uint32_t cycles); // the link stamp of data's frame, or cycles
+
+    static uint32_t getFrames();         // through a hooked input
+    static uint32_t getUnhooked()        { return _unhooked; }
+    static uint32_t getHits()            { return _hits; }
+    static uint32_t getMisses()          { return _misses; }
+    static uint32_t getBin(unsigned bin) { return _bins[bin < LINK_STAMP_BINS ? bin : LINK_STAMP_BINS-1]; }
+
+private:
+    static bool     find(const void* data, uint32_t* cycles);
+    static void     noteSaved(uint32_t cycles);
+
+    static uint32_t _unhooked;  // netifs found with no free slot
+    static uint32_t _hits;
+    static uint32_t _misses;
+    static uint32_t _bins[LINK_STAMP_BINS];
+};
+
+}
+
+#endif /* ESPLINKSTAMP_H_ */
@@ -0,0 +1,59 @@
+/*
+ * ESPPinInterrupt.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "ESPPinInterrupt.h"
+
+namespace hal
+{
+
+static std::function<void()> _handler;
+
+static ICACHE_RAM_ATTR void _isr()
+{
+    if (_handler)
+    {
+        _handler();
+    }
+}
+
+ESPPinInterrupt::ESPPinInterrupt(int pin) : _pin(pin)
+{
+}
+
+ESPPinInterrupt::~ESPPinInterrupt()
+{
+    detach();
+}
+
+void ESPPinInterrupt::attach(std::function<void()> handler)
+{
+    _handler = handler;
+    pinMode(_pin, INPUT);
+    attachInterrupt(_pin, _isr, RISING);
+}
+
+void ESPPinInterrupt::detach()
+{
+    detachInterrupt(_pin);
+    _handler = nullptr;
+}
+
+}
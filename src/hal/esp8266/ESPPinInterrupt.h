@@ -0,0 +1,49 @@
+/*
+ * ESPPinInterrupt.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ESPPININTERRUPT_H_
+#define ESPPININTERRUPT_H_
+
+#include "hal/PinInterrupt.h"
+
+namespace hal
+{
+
+//
+// attachInterrupt() on a GPIO, rising edge.  There is only one PPS so the
+// handler lives in a static for the IRAM trampoline.
+//
+class ESPPinInterrupt : public PinInterrupt
+{
+public:
+    ESPPinInterrupt(int pin);
+    virtual ~ESPPinInterrupt();
+
+    void attach(std::function<void()> handler) override;
+    void detach() override;
+
+private:
+    int _pin;
+};
+
+}
+
+#endif /* ESPPININTERRUPT_H_ */
@@ -0,0 +1,37 @@
+/*
+ * ESPRTCMemory.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "hal/RTCMemory.h"
+
+namespace hal
+{
+
+bool rtcRead(uint32_t offset, uint32_t* data, size_t size)
+{
+    return ESP.rtcUserMemoryRead(offset, data, size);
+}
+
+bool rtcWrite(uint32_t offset, uint32_t* data, size_t size)
+{
+    return ESP.rtcUserMemoryWrite(offset, data, size);
+}
+
+}
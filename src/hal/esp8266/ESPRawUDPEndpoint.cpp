@@ -0,0 +1,146 @@
+/*
+ * ESPRawUDPEndpoint.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include "ESPRawUDPEndpoint.h"
+#include "ESPLinkStamp.h"
+
+namespace hal
+{
+
+//
+// The received pbuf for the duration of the callback.  A datagram that
+// came in more than one pbuf (never a 48 byte request) has length() 0.
+//
+class ESPRawUDPPacket : public UDPPacket
+{
+public:
+    ESPRawUDPPacket(struct udp_pcb* pcb, struct pbuf* p, RawUDPAddr* addr, u16_t port, uint32_t rx_cycles) :
+        _pcb(pcb), _p(p), _addr(*addr), _port(port), _rx_cycles(rx_cycles) {}
+
+    size_t         length() override { return _p->len == _p->tot_len ? _p->len : 0; }
+    const uint8_t* data() override   { return (const uint8_t*)_p->payload; }
+    uint8_t*       edit() override   { return (uint8_t*)_p->payload; }
+    size_t         write(const uint8_t* data, size_t len) override
+    {
+        struct pbuf* q = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+        if (q == nullptr)
+        {
+            return 0;
+        }
+        pbuf_take(q, data, len);
+        err_t err = udp_sendto(_pcb, q, &_addr, _port);
+        pbuf_free(q);
+        return err == ERR_OK ? len : 0;
+    }
+    //
+    // udp_sendto() moves the payload back over the old headers if it can
+    // (otherwise it chains a header pbuf), the caller still frees _p.  The
+    // same pbuf_header() test it makes tells us which it will be.
+    //
+    size_t         reply() override
+    {
+        size_t len = length();
+        if (pbuf_header(_p, UDP_HLEN) == 0)
+        {
+            pbuf_header(_p, -UDP_HLEN);
+            ++ESPRawUDPEndpoint::_in_place;
+        }
+        else
+        {
+            ++ESPRawUDPEndpoint::_chained;
+        }
+        if (udp_sendto(_pcb, _p, &_addr, _port) != ERR_OK)
+        {
+            ++ESPRawUDPEndpoint::_failed;
+            return 0;
+        }
+        return len;
+    }
+    uint32_t       remoteIP() override { return RAW_UDP_IP4(&_addr); }
+#if defined(NTP_LINK_STAMP)
+    uint32_t       rxCycles() override { return ESPLinkStamp::earliest(data(), _rx_cycles); }
+#else
+    uint32_t       rxCycles() override { return _rx_cycles; }
+#endif
+
+private:
+    struct udp_pcb* _pcb;
+    struct pbuf*    _p;
+    ip_addr_t       _addr;
+    u16_t           _port;
+    uint32_t        _rx_cycles;
+};
+
+uint32_t ESPRawUDPEndpoint::_in_place;
+uint32_t ESPRawUDPEndpoint::_chained;
+uint32_t ESPRawUDPEndpoint::_failed;
+
+ESPRawUDPEndpoint::ESPRawUDPEndpoint() : _pcb(nullptr), _handler(nullptr), _arg(nullptr)
+{
+}
+
+ESPRawUDPEndpoint::~ESPRawUDPEndpoint()
+{
+    close();
+}
+
+bool ESPRawUDPEndpoint::listen(uint16_t port)
+{
+#if defined(NTP_LINK_STAMP)
+    ESPLinkStamp::install();
+#endif
+    close();
+    _pcb = udp_new();
+    if (_pcb == nullptr)
+    {
+        return false;
+    }
+    if (udp_bind(_pcb, IP_ADDR_ANY, port) != ERR_OK)
+    {
+        close();
+        return false;
+    }
+    udp_recv(_pcb, recv, this);
+    return true;
+}
+
+void ESPRawUDPEndpoint::close()
+{
+    if (_pcb != nullptr)
+    {
+        udp_remove(_pcb);
+        _pcb = nullptr;
+    }
+}
+
+void ESPRawUDPEndpoint::recv(void* arg, struct udp_pcb* pcb, struct pbuf* p, RawUDPAddr* addr, u16_t port)
+{
+    uint32_t rx_cycles = hal::cycles();
+    ESPRawUDPEndpoint* self = (ESPRawUDPEndpoint*)arg;
+    if (self->_handler != nullptr)
+    {
+        ESPRawUDPPacket packet(pcb, p, addr, port, rx_cycles);
+        self->_handler(self->_arg, packet);
+    }
+    pbuf_free(p);
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * ESPRawUDPEndpoint.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ESPRAWUDPENDPOINT_H_
+#define ESPRAWUDPENDPOINT_H_
+
+#include "hal/UDPEndpoint.h"
+#include "lwip/init.h"
+#include "lwip/udp.h"
+
+//
+// The core builds with lwIP 2 by default and 1.4 as an option, they
+// differ in the receive callback's address and how an IPv4 one is read.
+// With IPv6 in lwIP 2 a v6 sender reads as 0.0.0.0, which NTP answers
+// but never tracks.
+//
+#if LWIP_VERSION_MAJOR == 1
+typedef ip_addr_t RawUDPAddr;
+#define RAW_UDP_IP4(addr) ip4_addr_get_u32(addr)
+#else
+typedef const ip_addr_t RawUDPAddr;
+#define RAW_UDP_IP4(addr) ip_addr_get_ip4_u32(addr)
+#endif
+
+namespace hal
+{
+
+//
+// UDP straight on lwIP's raw API, built in place of ESPUDPEndpoint with
+// -DNTP_RAW_UDP (the 'rawudp' env in platformio.ini).  The udp_recv
+// callback stamps cycles() before anything else and hands the handler a
+// packet that wraps the received pbuf, reply() sends that same pbuf back
+// so an answer allocates nothing when lwIP can put the headers back in
+// front of the payload.  Whether it could is counted, a driver that hands
+// over frames it does not own (PBUF_REF) costs a header pbuf per reply.
+//
+class ESPRawUDPEndpoint : public UDPEndpoint
+{
+public:
+    ESPRawUDPEndpoint();
+    virtual ~ESPRawUDPEndpoint();
+
+    bool listen(uint16_t port) override;
+    void close() override;
+    void onPacket(UDPHandler handler, void* arg) override { _handler = handler; _arg = arg; }
+
+    static uint32_t getInPlace() { return _in_place; }
+    static uint32_t getChained() { return _chained; }
+    static uint32_t getFailed()  { return _failed; }
+
+private:
+    struct udp_pcb* _pcb;
+    UDPHandler      _handler;
+    void*           _arg;
+
+    static uint32_t _in_place;  // replies sent in the received pbuf
+    static uint32_t _chained;   // and those that needed a header pbuf
+    static uint32_t _failed;    // udp_sendto() said no (out of memory, no route)
+
+    friend class ESPRawUDPPacket;
+
+    static void recv(void* arg, struct udp_pcb* pcb, struct pbuf* p, RawUDPAddr* addr, u16_t port);
+};
+
+}
+
+#endif /* ESPRAWUDPENDPOINT_H_ */
@@ -0,0 +1,54 @@
+/*
+ * ESPTimer.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "ESPTimer.h"
+
+namespace hal
+{
+
+ESPTimer::ESPTimer() : _ticker(), _callback()
+{
+}
+
+ESPTimer::~ESPTimer()
+{
+    stop();
+}
+
+void ESPTimer::start(uint32_t ms)
+{
+    _ticker.once_ms(ms, _handler, this);
+}
+
+void ESPTimer::stop()
+{
+    _ticker.detach();
+}
+
+void ICACHE_RAM_ATTR ESPTimer::_handler(ESPTimer* timer)
+{
+    if (timer->_callback)
+    {
+        timer->_callback();
+    }
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+ * ESPTimer.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ESPTIMER_H_
+#define ESPTIMER_H_
+
+#include "hal/Timer.h"
+#include "Ticker.h"
+
+namespace hal
+{
+
+class ESPTimer : public Timer
+{
+public:
+    ESPTimer();
+    virtual ~ESPTimer();
+
+    void setCallback(std::function<void()> callback) override { _callback = callback; }
+    void start(uint32_t ms) override;
+    void stop() override;
+
+private:
+    Ticker                _ticker;
+    std::function<void()> _callback;
+
+    static void _handler(ESPTimer* timer);
+};
+
+}
+
+#endif /* ESPTIMER_H_ */
@@ -0,0 +1,93 @@
+/*
+ * ESPUDPEndpoint.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "ESPUDPEndpoint.h"
+#include "ESPLinkStamp.h"
+
+namespace hal
+{
+
+//
+// Wraps the AsyncUDPPacket for the duration of the callback.  Its data is
+// the payload of the received pbuf so edit() works in place, but AsyncUDP
+// does not hand out the pbuf: reply() still goes through write(), which
+// allocates a new one and copies into it.
+//
+class ESPUDPPacket : public UDPPacket
+{
+public:
+    ESPUDPPacket(AsyncUDPPacket& packet, uint32_t rx_cycles) : _packet(packet), _rx_cycles(rx_cycles) {}
+
+    size_t         length() override { return _packet.length(); }
+    const uint8_t* data() override   { return _packet.data(); }
+    size_t         write(const uint8_t* data, size_t len) override { return _packet.write(data, len); }
+    uint8_t*       edit() override   { return _packet.data(); }
+    size_t         reply() override  { return _packet.write(_packet.data(), _packet.length()); }
+    uint32_t       remoteIP() override { return (uint32_t)_packet.remoteIP(); }
+#if defined(NTP_LINK_STAMP)
+    uint32_t       rxCycles() override { return ESPLinkStamp::earliest(data(), _rx_cycles); }
+#else
+    uint32_t       rxCycles() override { return _rx_cycles; }
+#endif
+
+private:
+    AsyncUDPPacket& _packet;
+    uint32_t        _rx_cycles;
+};
+
+ESPUDPEndpoint::ESPUDPEndpoint() : _udp(), _handler(nullptr), _arg(nullptr)
+{
+}
+
+ESPUDPEndpoint::~ESPUDPEndpoint()
+{
+}
+
+bool ESPUDPEndpoint::listen(uint16_t port)
+{
+#if defined(NTP_LINK_STAMP)
+    ESPLinkStamp::install();
+#endif
+    return _udp.listen(port);
+}
+
+void ESPUDPEndpoint::close()
+{
+    _udp.close();
+}
+
+/*
+ * AsyncUDP has built its packet and gone through its own std::function by
+ * the time we get to stamp it.
+ */
+void ESPUDPEndpoint::onPacket(UDPHandler handler, void* arg)
+{
+    _handler = handler;
+    _arg     = arg;
+    _udp.onPacket([this](AsyncUDPPacket& aup)
+    {
+        uint32_t     rx_cycles = hal::cycles();
+        ESPUDPPacket packet(aup, rx_cycles);
+        _handler(_arg, packet);
+    });
+}
+
+}
@@ -0,0 +1,49 @@
+/*
+ * ESPUDPEndpoint.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef ESPUDPENDPOINT_H_
+#define ESPUDPENDPOINT_H_
+
+#include "hal/UDPEndpoint.h"
+#include "ESPAsyncUDP.h"
+
+namespace hal
+{
+
+class ESPUDPEndpoint : public UDPEndpoint
+{
+public:
+    ESPUDPEndpoint();
+    virtual ~ESPUDPEndpoint();
+
+    bool listen(uint16_t port) override;
+    void close() override;
+    void onPacket(UDPHandler handler, void* arg) override;
+
+private:
+    AsyncUDP   _udp;
+    UDPHandler _handler;
+    void*      _arg;
+};
+
+}
+
+#endif /* ESPUDPENDPOINT_H_ */
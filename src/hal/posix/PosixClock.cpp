@@ -0,0 +1,114 @@
+/*
+ * PosixClock.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <time.h>
+#include <sched.h>
+#include "PosixClock.h"
+#include "Timestamp.h"
+
+#define YIELD_NS 100000 // simulated time that passes on each yield()
+
+namespace hal
+{
+namespace posix
+{
+
+static bool     simulated;
+static uint64_t sim_ns;
+static uint64_t start_ns;
+
+static uint64_t monotonic()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void setSimulated(bool on)
+{
+    simulated = on;
+    sim_ns    = 0;
+}
+
+bool isSimulated()
+{
+    return simulated;
+}
+
+void setTime(uint64_t ns)
+{
+    sim_ns = ns;
+}
+
+void advance(uint64_t ns)
+{
+    sim_ns += ns;
+}
+
+uint64_t getTime()
+{
+    if (simulated)
+    {
+        return sim_ns;
+    }
+    if (start_ns == 0)
+    {
+        start_ns = monotonic();
+    }
+    return monotonic() - start_ns;
+}
+
+}
+
+uint32_t cycles()
+{
+    return (uint32_t)(posix::getTime() * CYCLES_PER_US / 1000);
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(posix::getTime() / 1000000);
+}
+
+void delay(uint32_t ms)
+{
+    if (posix::simulated)
+    {
+        posix::advance((uint64_t)ms * 1000000);
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec  = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&ts, nullptr);
+}
+
+void yield()
+{
+    if (posix::simulated)
+    {
+        posix::advance(YIELD_NS);
+        return;
+    }
+    sched_yield();
+}
+
+}
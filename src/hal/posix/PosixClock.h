@@ -0,0 +1,46 @@
+/*
+ * PosixClock.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef POSIXCLOCK_H_
+#define POSIXCLOCK_H_
+
+#include "hal/HAL.h"
+
+namespace hal
+{
+namespace posix
+{
+
+//
+// Host time behind hal::cycles()/millis().  By default it follows
+// CLOCK_MONOTONIC, in simulated mode it only moves when told to (and by a
+// little on each yield()/delay() so wait loops terminate).
+//
+void     setSimulated(bool simulated);
+bool     isSimulated();
+void     setTime(uint64_t ns);
+void     advance(uint64_t ns);
+uint64_t getTime();    // nanoseconds since start (or simulated)
+
+}
+}
+
+#endif /* POSIXCLOCK_H_ */
@@ -0,0 +1,112 @@
+/*
+ * PosixFileSystem.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "PosixFileSystem.h"
+
+namespace hal
+{
+
+PosixFileSystem::PosixFileSystem(const char* root) : _root(root)
+{
+}
+
+PosixFileSystem::~PosixFileSystem()
+{
+}
+
+std::string PosixFileSystem::path(const char* name)
+{
+    return _root + (name[0] == '/' ? "" : "/") + name;
+}
+
+bool PosixFileSystem::begin()
+{
+    struct stat st;
+    if (stat(_root.c_str(), &st) == 0)
+    {
+        return S_ISDIR(st.st_mode);
+    }
+    return mkdir(_root.c_str(), 0755) == 0;
+}
+
+bool PosixFileSystem::format()
+{
+    list([this](const char* name, size_t size)
+    {
+        (void)size;
+        unlink(path(name).c_str());
+    });
+    return true;
+}
+
+bool PosixFileSystem::exists(const char* name)
+{
+    return access(path(name).c_str(), F_OK) == 0;
+}
+
+int PosixFileSystem::read(const char* name, char* buffer, size_t size)
+{
+    FILE* f = fopen(path(name).c_str(), "rb");
+    if (f == nullptr)
+    {
+        return -1;
+    }
+    size_t len = fread(buffer, 1, size, f);
+    fclose(f);
+    return (int)len;
+}
+
+bool PosixFileSystem::write(const char* name, const char* data, size_t len)
+{
+    FILE* f = fopen(path(name).c_str(), "wb");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    size_t written = fwrite(data, 1, len, f);
+    fclose(f);
+    return written == len;
+}
+
+void PosixFileSystem::list(std::function<void(const char* name, size_t size)> callback)
+{
+    DIR* dir = opendir(_root.c_str());
+    if (dir == nullptr)
+    {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        struct stat st;
+        std::string name = std::string("/") + entry->d_name;
+        if (stat(path(name.c_str()).c_str(), &st) == 0 && S_ISREG(st.st_mode))
+        {
+            callback(name.c_str(), (size_t)st.st_size);
+        }
+    }
+    closedir(dir);
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+ * PosixLog.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <stdarg.h>
+#include "PosixLog.h"
+#include "PosixClock.h"
+
+static const char level_char[] = "EWID";
+
+DLog& DLog::getLog()
+{
+    static DLog log;
+    return log;
+}
+
+void DLog::log(Level level, const char* tag, const char* fmt, va_list ap)
+{
+    if (level > _level)
+    {
+        return;
+    }
+    uint64_t ns = hal::posix::getTime();
+    fprintf(stderr, "%6lu.%06lu %c %s: ", (unsigned long)(ns / 1000000000ULL),
+            (unsigned long)(ns % 1000000000ULL / 1000), level_char[level], tag);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+}
+
+#define LOG_LEVEL(name, level)                              \
+    void DLog::name(const char* tag, const char* fmt, ...)  \
+    {                                                       \
+        va_list ap;                                         \
+        va_start(ap, fmt);                                  \
+        log(level, tag, fmt, ap);                           \
+        va_end(ap);                                         \
+    }
+
+LOG_LEVEL(error,   ERROR)
+LOG_LEVEL(warning, WARNING)
+LOG_LEVEL(info,    INFO)
+LOG_LEVEL(debug,   DEBUG)
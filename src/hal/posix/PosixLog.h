@@ -0,0 +1,57 @@
+/*
+ * PosixLog.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef POSIXLOG_H_
+#define POSIXLOG_H_
+
+#include <stdarg.h>
+#include "hal/HAL.h"
+
+//
+// Stand-in for DLog on the host: same calls, printed to stderr.
+//
+class DLog
+{
+public:
+    typedef enum
+    {
+        ERROR = 0,
+        WARNING,
+        INFO,
+        DEBUG
+    } Level;
+
+    static DLog& getLog();
+
+    void setLevel(Level level) { _level = level; }
+
+    void error(const char* tag, const char* fmt, ...);
+    void warning(const char* tag, const char* fmt, ...);
+    void info(const char* tag, const char* fmt, ...);
+    void debug(const char* tag, const char* fmt, ...);
+
+private:
+    DLog() : _level(INFO) {}
+    Level _level;
+    void  log(Level level, const char* tag, const char* fmt, va_list ap);
+};
+
+#endif /* POSIXLOG_H_ */
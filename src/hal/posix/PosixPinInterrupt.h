@@ -0,0 +1,50 @@
+/*
+ * PosixPinInterrupt.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef POSIXPININTERRUPT_H_
+#define POSIXPININTERRUPT_H_
+
+#include "hal/PinInterrupt.h"
+
+namespace hal
+{
+
+//
+// The host has no pins, whoever models the PPS sets the clock to the
+// edge time and calls fire().
+//
+class PosixPinInterrupt : public PinInterrupt
+{
+public:
+    PosixPinInterrupt() : _handler() {}
+    virtual ~PosixPinInterrupt() {}
+
+    void attach(std::function<void()> handler) override { _handler = handler; }
+    void detach() override                              { _handler = nullptr; }
+    void fire()                                         { if (_handler) _handler(); }
+
+private:
+    std::function<void()> _handler;
+};
+
+}
+
+#endif /* POSIXPININTERRUPT_H_ */
@@ -0,0 +1,54 @@
+/*
+ * PosixRTCMemory.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "hal/RTCMemory.h"
+
+#define RTC_USER_SIZE 512 // bytes, same as the ESP8266
+
+namespace hal
+{
+
+//
+// Survives nothing, but lets the checkpoint code run on the host.
+//
+static uint32_t rtc_memory[RTC_USER_SIZE/4];
+
+bool rtcRead(uint32_t offset, uint32_t* data, size_t size)
+{
+    if (offset * 4 + size > RTC_USER_SIZE)
+    {
+        return false;
+    }
+    memcpy(data, &rtc_memory[offset], size);
+    return true;
+}
+
+bool rtcWrite(uint32_t offset, uint32_t* data, size_t size)
+{
+    if (offset * 4 + size > RTC_USER_SIZE)
+    {
+        return false;
+    }
+    memcpy(&rtc_memory[offset], data, size);
+    return true;
+}
+
+}
@@ -0,0 +1,147 @@
+/*
+ * PosixSerial.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include "PosixSerial.h"
+#include "Timestamp.h"
+
+namespace hal
+{
+
+PosixSerial::PosixSerial() :
+    _head(0),
+    _tail(0),
+    _stamp_head(0),
+    _stamp_tail(0),
+    _overflows(0),
+    _stamp_overflows(0),
+    _baud(0),
+    _char_cycles(0),
+    _on_write()
+{
+    setBaud(9600);
+}
+
+PosixSerial::~PosixSerial()
+{
+}
+
+void PosixSerial::setBaud(uint32_t baud)
+{
+    _baud        = baud;
+    _char_cycles = CYCLES_PER_SEC / baud * 10;
+}
+
+void PosixSerial::inject(const uint8_t* data, size_t len, uint32_t cycles)
+{
+    for (size_t k = 0; k < len; ++k)
+    {
+        uint32_t index = _head;
+        if (push(data + k, 1) && (data[k] == '$' || data[k] == 0xb5))
+        {
+            addStamp(index, cycles + k * _char_cycles);
+        }
+    }
+}
+
+size_t PosixSerial::push(const uint8_t* data, size_t len)
+{
+    size_t count = 0;
+    for (size_t k = 0; k < len; ++k)
+    {
+        if (_head - _tail >= POSIX_SERIAL_RX_SIZE)
+        {
+            ++_overflows;
+            continue;
+        }
+        _rx[_head & (POSIX_SERIAL_RX_SIZE-1)] = data[k];
+        ++_head;
+        ++count;
+    }
+    return count;
+}
+
+void PosixSerial::addStamp(uint32_t index, uint32_t cycles)
+{
+    if (_stamp_head - _stamp_tail >= POSIX_SERIAL_STAMP_SIZE)
+    {
+        ++_stamp_overflows;
+        return;
+    }
+    Stamp& stamp = _stamps[_stamp_head & (POSIX_SERIAL_STAMP_SIZE-1)];
+    stamp.index  = index;
+    stamp.cycles = cycles;
+    ++_stamp_head;
+}
+
+int PosixSerial::available()
+{
+    return (int)(_head - _tail);
+}
+
+int PosixSerial::read()
+{
+    if (_head == _tail)
+    {
+        return -1;
+    }
+    return _rx[_tail++ & (POSIX_SERIAL_RX_SIZE-1)];
+}
+
+size_t PosixSerial::read(char* buffer, size_t size)
+{
+    size_t count = 0;
+    while (count < size && _tail != _head)
+    {
+        buffer[count++] = (char)_rx[_tail++ & (POSIX_SERIAL_RX_SIZE-1)];
+    }
+    return count;
+}
+
+size_t PosixSerial::write(const uint8_t* data, size_t len)
+{
+    if (_on_write)
+    {
+        _on_write(data, len);
+    }
+    return len;
+}
+
+bool PosixSerial::getStamp(uint32_t index, uint32_t* cycles)
+{
+    while (_stamp_tail != _stamp_head)
+    {
+        Stamp& stamp = _stamps[_stamp_tail & (POSIX_SERIAL_STAMP_SIZE-1)];
+        int32_t diff = (int32_t)(stamp.index - index);
+        if (diff > 0)
+        {
+            return false;
+        }
+        ++_stamp_tail;
+        if (diff == 0)
+        {
+            *cycles = stamp.cycles;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+ * PosixSerial.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef POSIXSERIAL_H_
+#define POSIXSERIAL_H_
+
+#include "hal/SerialPort.h"
+
+#define POSIX_SERIAL_RX_SIZE    4096 // receive ring, must be a power of 2
+#define POSIX_SERIAL_STAMP_SIZE 64   // timestamp ring, must be a power of 2
+
+namespace hal
+{
+
+//
+// In-memory GPS UART.  A model pushes bytes in with inject() along with
+// the cycle count of the first one's start bit, the '$'/0xb5 stamps are
+// derived from the baud rate like GPSSerial does.  A replay has the
+// stamps already and uses push() and addStamp().
+//
+class PosixSerial : public SerialPort
+{
+public:
+    PosixSerial();
+    virtual ~PosixSerial();
+
+    void     inject(const uint8_t* data, size_t len, uint32_t cycles);
+    size_t   push(const uint8_t* data, size_t len);
+    void     addStamp(uint32_t index, uint32_t cycles);
+    uint32_t getWriteIndex() { return _head; }  // stream index of the next byte pushed
+    void     onWrite(std::function<void(const uint8_t*, size_t)> handler) { _on_write = handler; }
+
+    int      available() override;
+    int      read() override;
+    size_t   read(char* buffer, size_t size) override;
+    size_t   write(const uint8_t* data, size_t len) override;
+    void     flush() override {}
+    void     setBaud(uint32_t baud) override;
+    uint32_t getBaud() override { return _baud; }
+
+    uint32_t getReadIndex() override { return _tail; }
+    bool     getStamp(uint32_t index, uint32_t* cycles) override;
+
+    uint32_t getOverflows() override      { return _overflows; }
+    uint32_t getFIFOOverflows() override  { return 0; }
+    uint32_t getStampOverflows() override { return _stamp_overflows; }
+
+private:
+    typedef struct stamp
+    {
+        uint32_t index;
+        uint32_t cycles;
+    } Stamp;
+
+    uint32_t _head;
+    uint32_t _tail;
+    uint8_t  _rx[POSIX_SERIAL_RX_SIZE];
+    uint32_t _stamp_head;
+    uint32_t _stamp_tail;
+    Stamp    _stamps[POSIX_SERIAL_STAMP_SIZE];
+    uint32_t _overflows;
+    uint32_t _stamp_overflows;
+    uint32_t _baud;
+    uint32_t _char_cycles;
+    std::function<void(const uint8_t*, size_t)> _on_write;
+};
+
+}
+
+#endif /* POSIXSERIAL_H_ */
@@ -0,0 +1,83 @@
+/*
+ * PosixTimer.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <algorithm>
+#include "PosixTimer.h"
+#include "PosixClock.h"
+
+namespace hal
+{
+
+std::vector<PosixTimer*> PosixTimer::_timers;
+
+PosixTimer::PosixTimer() : _callback(), _armed(false), _deadline(0)
+{
+    _timers.push_back(this);
+}
+
+PosixTimer::~PosixTimer()
+{
+    _timers.erase(std::remove(_timers.begin(), _timers.end(), this), _timers.end());
+}
+
+void PosixTimer::start(uint32_t ms)
+{
+    _deadline = posix::getTime() + (uint64_t)ms * 1000000;
+    _armed    = true;
+}
+
+void PosixTimer::stop()
+{
+    _armed = false;
+}
+
+void PosixTimer::poll()
+{
+    uint64_t now = posix::getTime();
+    for (size_t i = 0; i < _timers.size(); ++i)
+    {
+        PosixTimer* timer = _timers[i];
+        if (timer->_armed && now >= timer->_deadline)
+        {
+            timer->_armed = false;  // the callback may re-arm
+            if (timer->_callback)
+            {
+                timer->_callback();
+            }
+        }
+    }
+}
+
+bool PosixTimer::next(uint64_t* ns)
+{
+    bool found = false;
+    for (PosixTimer* timer : _timers)
+    {
+        if (timer->_armed && (!found || timer->_deadline < *ns))
+        {
+            *ns   = timer->_deadline;
+            found = true;
+        }
+    }
+    return found;
+}
+
+}
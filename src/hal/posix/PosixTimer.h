@@ -0,0 +1,58 @@
+/*
+ * PosixTimer.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef POSIXTIMER_H_
+#define POSIXTIMER_H_
+
+#include <vector>
+#include "hal/Timer.h"
+
+namespace hal
+{
+
+//
+// Timers expire when poll() is called at or after their deadline on the
+// host clock (see PosixClock.h).
+//
+class PosixTimer : public Timer
+{
+public:
+    PosixTimer();
+    virtual ~PosixTimer();
+
+    void setCallback(std::function<void()> callback) override { _callback = callback; }
+    void start(uint32_t ms) override;
+    void stop() override;
+
+    static void poll();
+    static bool next(uint64_t* ns);  // earliest armed deadline
+
+private:
+    std::function<void()> _callback;
+    bool                  _armed;
+    uint64_t              _deadline;  // ns
+
+    static std::vector<PosixTimer*> _timers;
+};
+
+}
+
+#endif /* POSIXTIMER_H_ */
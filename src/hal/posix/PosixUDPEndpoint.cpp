@@ -0,0 +1,125 @@
+/*
+ * PosixUDPEndpoint.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "PosixUDPEndpoint.h"
+
+namespace hal
+{
+
+class PosixUDPPacket : public UDPPacket
+{
+public:
+    PosixUDPPacket(int fd, uint8_t* data, size_t len, const struct sockaddr_in& from, uint32_t rx_cycles) :
+        _fd(fd), _data(data), _len(len), _from(from), _rx_cycles(rx_cycles) {}
+
+    size_t         length() override { return _len; }
+    const uint8_t* data() override   { return _data; }
+    size_t write(const uint8_t* data, size_t len) override
+    {
+        ssize_t sent = sendto(_fd, data, len, 0, (const struct sockaddr*)&_from, sizeof(_from));
+        return sent < 0 ? 0 : (size_t)sent;
+    }
+    uint8_t*       edit() override   { return _data; }
+    size_t         reply() override  { return write(_data, _len); }
+    uint32_t       remoteIP() override { return _from.sin_addr.s_addr; }
+    uint32_t       rxCycles() override { return _rx_cycles; }
+
+private:
+    int                 _fd;
+    uint8_t*            _data;
+    size_t              _len;
+    struct sockaddr_in  _from;
+    uint32_t            _rx_cycles;
+};
+
+PosixUDPEndpoint::PosixUDPEndpoint(uint16_t port_offset) : _port_offset(port_offset), _fd(-1), _handler(nullptr), _arg(nullptr)
+{
+}
+
+PosixUDPEndpoint::~PosixUDPEndpoint()
+{
+    close();
+}
+
+bool PosixUDPEndpoint::listen(uint16_t port)
+{
+    close();
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0)
+    {
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons((uint16_t)(port + _port_offset));
+    if (bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        close();
+        return false;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+void PosixUDPEndpoint::close()
+{
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+int PosixUDPEndpoint::process()
+{
+    int count = 0;
+    while (_fd >= 0)
+    {
+        uint8_t            buffer[POSIX_UDP_MAX_PACKET];
+        struct sockaddr_in from;
+        socklen_t          from_len = sizeof(from);
+        ssize_t len = recvfrom(_fd, buffer, sizeof(buffer), 0, (struct sockaddr*)&from, &from_len);
+        uint32_t rx_cycles = hal::cycles();
+        if (len < 0)
+        {
+            break;
+        }
+        if (_handler)
+        {
+            PosixUDPPacket packet(_fd, buffer, (size_t)len, from, rx_cycles);
+            _handler(_arg, packet);
+        }
+        ++count;
+    }
+    return count;
+}
+
+}
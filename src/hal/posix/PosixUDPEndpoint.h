@@ -0,0 +1,59 @@
+/*
+ * PosixUDPEndpoint.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef POSIXUDPENDPOINT_H_
+#define POSIXUDPENDPOINT_H_
+
+#include "hal/UDPEndpoint.h"
+
+#define POSIX_UDP_MAX_PACKET 1500
+
+namespace hal
+{
+
+//
+// Non-blocking BSD socket, process() delivers whatever has arrived.
+// 'port_offset' is added to the port asked for so the server can run
+// unprivileged (123 -> 12123).
+//
+class PosixUDPEndpoint : public UDPEndpoint
+{
+public:
+    PosixUDPEndpoint(uint16_t port_offset = 0);
+    virtual ~PosixUDPEndpoint();
+
+    bool listen(uint16_t port) override;
+    void close() override;
+    void onPacket(UDPHandler handler, void* arg) override { _handler = handler; _arg = arg; }
+
+    int  process();   // packets handled
+    int  getFD()      { return _fd; }
+
+private:
+    uint16_t _port_offset;
+    int      _fd;
+    UDPHandler _handler;
+    void*    _arg;
+};
+
+}
+
+#endif /* POSIXUDPENDPOINT_H_ */
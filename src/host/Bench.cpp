@@ -0,0 +1,49 @@
+/*
+ * Bench.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 11, 2018
+ *      Author: chris.l
+ */
+
+#include <unistd.h>
+#include "Commands.h"
+#include "Benchmark.h"
+#include "Log.h"
+
+/*
+ * The same benchmarks the 'benchmark' env runs on the device.  Cycles
+ * here are host nanoseconds scaled to F_CPU so the two line up.
+ */
+int bench(int argc, char** argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'v':
+            dlog.setLevel(DLog::DEBUG);
+            break;
+        default:
+            fprintf(stderr, "usage: bench [-v]\n");
+            return 2;
+        }
+    }
+
+    benchmark();
+    return 0;
+}
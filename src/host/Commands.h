@@ -0,0 +1,52 @@
+/*
+ * Commands.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef COMMANDS_H_
+#define COMMANDS_H_
+
+//
+// Host subcommands, "espntp <command> [options]".  Each returns the exit
+// status.
+//
+typedef int (*CommandFunc)(int argc, char** argv);
+
+typedef struct command
+{
+    const char* name;
+    CommandFunc run;
+    const char* help;
+} Command;
+
+//
+// SIGINT/SIGTERM set 'stopping', long running commands check it.
+//
+extern volatile bool stopping;
+void catchSignals();
+
+int serve(int argc, char** argv);
+int record(int argc, char** argv);
+int replay(int argc, char** argv);
+int simulate(int argc, char** argv);
+int load(int argc, char** argv);
+int bench(int argc, char** argv);
+int mru(int argc, char** argv);
+
+#endif /* COMMANDS_H_ */
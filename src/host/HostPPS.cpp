@@ -0,0 +1,80 @@
+/*
+ * HostPPS.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <time.h>
+#include "HostPPS.h"
+#include "Timestamp.h"
+
+HostPPS::HostPPS(hal::PosixPinInterrupt& pps, hal::PosixSerial& serial) :
+    _pps(pps),
+    _serial(serial),
+    _sats(8),
+    _fix(true)
+{
+}
+
+HostPPS::~HostPPS()
+{
+}
+
+void HostPPS::pulse(time_t seconds)
+{
+    _pps.fire();
+    sentences(seconds, hal::cycles());
+}
+
+/*
+ * RMC and GGA for 'seconds', the first '$' arriving at 'cycles'.
+ */
+void HostPPS::sentences(time_t seconds, uint32_t cycles)
+{
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+
+    char body[HOST_NMEA_SIZE];
+    char rmc[HOST_NMEA_SIZE];
+    char gga[HOST_NMEA_SIZE];
+
+    snprintf(body, sizeof(body), "GPRMC,%02d%02d%02d.00,%c,4217.0000,N,07106.0000,W,0.0,0.0,%02d%02d%02d,,,A",
+            tm.tm_hour, tm.tm_min, tm.tm_sec, _fix ? 'A' : 'V', tm.tm_mday, tm.tm_mon+1, tm.tm_year % 100);
+    size_t rmc_len = sentence(rmc, sizeof(rmc), body);
+
+    snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,4217.0000,N,07106.0000,W,%d,%02u,1.0,30.0,M,-33.0,M,,",
+            tm.tm_hour, tm.tm_min, tm.tm_sec, _fix ? 1 : 0, _sats);
+    size_t gga_len = sentence(gga, sizeof(gga), body);
+
+    _serial.inject((const uint8_t*)rmc, rmc_len, cycles);
+    _serial.inject((const uint8_t*)gga, gga_len, cycles + (uint32_t)rmc_len * (CYCLES_PER_SEC / _serial.getBaud() * 10));
+}
+
+/*
+ * Wrap 'body' in '$' ... '*hh\r\n', returns the length.
+ */
+size_t HostPPS::sentence(char* buffer, size_t size, const char* body)
+{
+    uint8_t checksum = 0;
+    for (const char* p = body; *p; ++p)
+    {
+        checksum ^= (uint8_t)*p;
+    }
+    int len = snprintf(buffer, size, "$%s*%02X\r\n", body, checksum);
+    return len < 0 ? 0 : (size_t)len < size ? (size_t)len : size-1;
+}
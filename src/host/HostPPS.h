@@ -0,0 +1,55 @@
+/*
+ * HostPPS.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#ifndef HOSTPPS_H_
+#define HOSTPPS_H_
+
+#include "hal/posix/PosixPinInterrupt.h"
+#include "hal/posix/PosixSerial.h"
+
+#define HOST_NMEA_SIZE 96  // longest sentence we generate
+
+//
+// Stands in for the GPS receiver on the host: pulse() raises the PPS
+// interrupt "now" and then sends the RMC and GGA for that second, the
+// same as a receiver does right after its time pulse.
+//
+class HostPPS
+{
+public:
+    HostPPS(hal::PosixPinInterrupt& pps, hal::PosixSerial& serial);
+    virtual ~HostPPS();
+
+    void          pulse(time_t seconds);
+    void          sentences(time_t seconds, uint32_t cycles);
+    void          setSatellites(uint8_t sats) { _sats = sats; }
+    void          setFix(bool fix)            { _fix = fix; }
+
+    static size_t sentence(char* buffer, size_t size, const char* body);
+
+private:
+    hal::PosixPinInterrupt& _pps;
+    hal::PosixSerial&       _serial;
+    uint8_t                 _sats;
+    bool                    _fix;
+};
+
+#endif /* HOSTPPS_H_ */
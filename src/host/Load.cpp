@@ -0,0 +1,492 @@
+/*
+ * Load.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 10, 2018
+ *      Author: chris.l
+ */
+
+#include <time.h>
+#include <math.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "Commands.h"
+#include "Log.h"
+#include "NTP.h"
+#include "Timestamp.h"
+
+static const char* TAG = "load";
+
+#define LOAD_MAX_CLIENTS   256
+#define LOAD_BATCH         64      // most requests sent before we look for replies
+#define LOAD_HIST_BINS     24      // log2 microsecond bins, the last is everything bigger
+#define LOAD_KNEE_LOSS     0.01    // a sweep step past this loss ...
+#define LOAD_KNEE_LATENCY  2.0     // ... or this many times the first step's median latency is past the knee
+#define LOAD_NS_PER_SEC    1000000000ULL
+
+static uint64_t monotonic()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * LOAD_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static Timestamp ntpNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return TS_MAKE(toNTP(ts.tv_sec), ((uint64_t)ts.tv_nsec << 32) / LOAD_NS_PER_SEC);
+}
+
+static double ts2us(int64_t ts)
+{
+    return (double)ts * 1e6 / 4294967296.0;
+}
+
+static Timestamp getTimestamp(const NTPTime& time)
+{
+    return TS_MAKE(ntohl(time.seconds), ntohl(time.fraction));
+}
+
+//
+// log2 histogram of microsecond magnitudes, signed values get a side each.
+//
+class Histogram
+{
+public:
+    Histogram() : _negative(), _positive() {}
+
+    void add(double us)
+    {
+        uint32_t* bins = us < 0 ? _negative : _positive;
+        double    mag  = fabs(us);
+        int       bin  = 0;
+        while (bin < LOAD_HIST_BINS-1 && mag >= (double)(1UL << bin))
+        {
+            ++bin;
+        }
+        ++bins[bin];
+    }
+
+    void print(const char* name)
+    {
+        printf("%s histogram (us):\n", name);
+        for (int bin = LOAD_HIST_BINS-1; bin >= 0; --bin)
+        {
+            row("-", bin, _negative[bin]);
+        }
+        for (int bin = 0; bin < LOAD_HIST_BINS; ++bin)
+        {
+            row("", bin, _positive[bin]);
+        }
+    }
+
+private:
+    uint32_t _negative[LOAD_HIST_BINS];
+    uint32_t _positive[LOAD_HIST_BINS];
+
+    void row(const char* sign, int bin, uint32_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (bin == LOAD_HIST_BINS-1)
+        {
+            printf("  %s[%lu, ...)", sign, 1UL << (bin-1));
+        }
+        else
+        {
+            printf("  %s[%lu, %lu)", sign, bin ? 1UL << (bin-1) : 0UL, 1UL << bin);
+        }
+        printf("\t%u\n", count);
+    }
+};
+
+typedef struct load_params
+{
+    struct sockaddr_storage server;
+    socklen_t               server_len;
+    double                  rate;      // requests per second, all clients
+    uint32_t                clients;   // sockets (source ports) the requests are spread over
+    uint32_t                seconds;
+    uint32_t                timeout_ms;
+} LoadParams;
+
+typedef struct load_result
+{
+    double              rate;          // offered
+    uint32_t            sent;
+    uint32_t            received;
+    uint32_t            kods;          // RATE Kiss-o'-Death replies, the server's limit not its capacity
+    uint32_t            unmatched;     // replies we did not ask for (or already timed out)
+    uint32_t            bad;           // too short or not a server reply
+    uint32_t            send_errors;
+    double              elapsed;       // seconds from the first send to the last reply
+    std::vector<double> latency;       // us, send to receive on our monotonic clock
+    std::vector<double> delay;         // us, RFC 5905 round trip delay
+    std::vector<double> offset;        // us, RFC 5905 offset
+    Histogram           delay_hist;
+    Histogram           offset_hist;
+} LoadResult;
+
+typedef struct load_pending
+{
+    uint64_t  sent_ns;    // monotonic
+    Timestamp t1;         // our transmit timestamp, echoed back as the origin
+} Pending;
+
+static double percentile(std::vector<double>& values, double p)
+{
+    if (values.empty())
+    {
+        return NAN;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)ceil(p / 100.0 * (double)values.size());
+    return values[rank > 0 ? rank-1 : 0];
+}
+
+/*
+ * Send 'rate' requests per second for 'seconds' spread round robin over
+ * the clients, then wait 'timeout_ms' for stragglers.  Requests are
+ * paced open loop (they go out on schedule whether or not earlier ones
+ * were answered) and replies are matched by their origin timestamp.
+ */
+static bool run(const LoadParams& params, LoadResult* result)
+{
+    std::vector<int> fds;
+    for (uint32_t i = 0; i < params.clients; ++i)
+    {
+        int fd = socket(params.server.ss_family, SOCK_DGRAM, 0);
+        if (fd < 0 || connect(fd, (const struct sockaddr*)&params.server, params.server_len) < 0)
+        {
+            dlog.error(TAG, "can't create client socket %u", i);
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            for (int open_fd : fds)
+            {
+                close(open_fd);
+            }
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fds.push_back(fd);
+    }
+
+    std::vector<struct pollfd> pfds(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i)
+    {
+        pfds[i].fd     = fds[i];
+        pfds[i].events = POLLIN;
+    }
+
+    std::unordered_map<uint64_t, Pending> pending;
+    uint64_t total      = (uint64_t)(params.rate * params.seconds);
+    uint64_t interval   = (uint64_t)((double)LOAD_NS_PER_SEC / params.rate);
+    uint64_t timeout_ns = (uint64_t)params.timeout_ms * 1000000;
+    uint64_t start      = monotonic();
+    uint64_t last_rx    = start;
+    uint64_t next       = 0;
+    size_t   client     = 0;
+
+    result->rate = params.rate;
+
+    while (!stopping)
+    {
+        uint64_t now = monotonic();
+
+        //
+        // everything that is due, but not so many that replies pile up
+        //
+        for (int batch = 0; batch < LOAD_BATCH && next < total && start + next * interval <= now; ++batch, ++next)
+        {
+            NTPPacket request;
+            memset(&request, 0, sizeof(request));
+            request.flags = (4 << 3) | 3;  // version 4, client
+
+            Timestamp t1 = ntpNow();
+            while (pending.count(t1))
+            {
+                ++t1;  // keep origin timestamps unique
+            }
+            request.xmit_time.seconds  = htonl(TS_SECONDS(t1));
+            request.xmit_time.fraction = htonl(TS_FRACTION(t1));
+
+            uint64_t sent_ns = monotonic();
+            if (send(fds[client], &request, sizeof(request), 0) != (ssize_t)sizeof(request))
+            {
+                ++result->send_errors;
+            }
+            else
+            {
+                pending[t1] = {sent_ns, t1};
+                ++result->sent;
+            }
+            client = (client + 1) % fds.size();
+        }
+
+        if (next >= total && (pending.empty() || now - start >= (uint64_t)params.seconds * LOAD_NS_PER_SEC + timeout_ns))
+        {
+            break;
+        }
+
+        uint64_t wait_ns = next < total && start + next * interval > now ? start + next * interval - now : 0;
+        if (next >= total)
+        {
+            wait_ns = 1000000;
+        }
+        if (poll(pfds.data(), pfds.size(), (int)MIN(wait_ns / 1000000, 100)) <= 0)
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < pfds.size(); ++i)
+        {
+            if (!(pfds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            NTPPacket reply;
+            ssize_t   len;
+            while ((len = recv(pfds[i].fd, &reply, sizeof(reply), 0)) >= 0)
+            {
+                Timestamp t4   = ntpNow();
+                uint64_t  rxns = monotonic();
+                if ((size_t)len < sizeof(reply) || (reply.flags & 0x07) != 4)
+                {
+                    ++result->bad;
+                    continue;
+                }
+
+                auto it = pending.find(getTimestamp(reply.orig_time));
+                if (it == pending.end())
+                {
+                    ++result->unmatched;
+                    continue;
+                }
+
+                if (reply.stratum == 0)
+                {
+                    pending.erase(it);
+                    ++result->kods;
+                    continue;
+                }
+
+                Timestamp t1 = it->second.t1;
+                Timestamp t2 = getTimestamp(reply.recv_time);
+                Timestamp t3 = getTimestamp(reply.xmit_time);
+                double latency = (double)(rxns - it->second.sent_ns) / 1000.0;
+                double delay   = ts2us((int64_t)(t4 - t1) - (int64_t)(t3 - t2));
+                double offset  = (ts2us((int64_t)(t2 - t1)) + ts2us((int64_t)(t3 - t4))) / 2;
+                pending.erase(it);
+
+                ++result->received;
+                result->latency.push_back(latency);
+                result->delay.push_back(delay);
+                result->offset.push_back(offset);
+                result->delay_hist.add(delay);
+                result->offset_hist.add(offset);
+                last_rx = rxns;
+            }
+        }
+    }
+
+    result->elapsed = (double)(MAX(last_rx, start + next * interval) - start) / 1e9;
+    for (int fd : fds)
+    {
+        close(fd);
+    }
+    return true;
+}
+
+static void report(LoadResult& result)
+{
+    uint32_t lost = result.sent - result.received - result.kods;
+    printf("offered:%.1f/s sent:%u received:%u kods:%u lost:%u (%.2f%%) unmatched:%u bad:%u send_errors:%u\n",
+            result.rate, result.sent, result.received, result.kods, lost, result.sent ? 100.0 * lost / result.sent : 0.0,
+            result.unmatched, result.bad, result.send_errors);
+    printf("throughput:%.1f/s over %.3fs\n", result.elapsed > 0 ? result.received / result.elapsed : 0.0, result.elapsed);
+
+    struct
+    {
+        const char*          name;
+        std::vector<double>& values;
+    } series[] =
+    {
+        {"latency", result.latency},
+        {"delay",   result.delay},
+        {"offset",  result.offset},
+    };
+    for (auto& s : series)
+    {
+        printf("%-8s us min:%.1f p50:%.1f p90:%.1f p99:%.1f max:%.1f\n", s.name,
+                percentile(s.values, 0), percentile(s.values, 50), percentile(s.values, 90),
+                percentile(s.values, 99), percentile(s.values, 100));
+    }
+    result.delay_hist.print("delay");
+    result.offset_hist.print("offset");
+}
+
+/*
+ * Step the offered rate until the server falls behind, print a CSV row
+ * per step and the last rate before the knee.
+ */
+static int sweep(LoadParams params, double from, double step, double to)
+{
+    printf("rate,sent,received,kods,loss,throughput,latency_p50_us,latency_p99_us,delay_p50_us,offset_p50_us\n");
+
+    double base = 0;
+    double knee = 0;
+    for (double rate = from; rate <= to && !stopping; rate += step)
+    {
+        params.rate = rate;
+        LoadResult result = LoadResult();
+        if (!run(params, &result))
+        {
+            return 1;
+        }
+
+        double loss       = result.sent ? (double)(result.sent - result.received - result.kods) / result.sent : 1.0;
+        double throughput = result.elapsed > 0 ? result.received / result.elapsed : 0.0;
+        double latency    = percentile(result.latency, 50);
+        printf("%.1f,%u,%u,%u,%.4f,%.1f,%.1f,%.1f,%.1f,%.1f\n", rate, result.sent, result.received, result.kods, loss, throughput,
+                latency, percentile(result.latency, 99), percentile(result.delay, 50), percentile(result.offset, 50));
+        fflush(stdout);
+
+        if (base == 0)
+        {
+            base = latency;
+        }
+        if (loss > LOAD_KNEE_LOSS || !(latency <= base * LOAD_KNEE_LATENCY))
+        {
+            dlog.info(TAG, "knee: %.1f requests/s (%.1f is past it)", knee, rate);
+            return 0;
+        }
+        knee = rate;
+    }
+    dlog.info(TAG, "no knee up to %.1f requests/s", knee);
+    return 0;
+}
+
+static bool resolve(const char* host, const char* port, LoadParams* params)
+{
+    struct addrinfo hints;
+    struct addrinfo* info;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port, &hints, &info) != 0)
+    {
+        return false;
+    }
+    memcpy(&params->server, info->ai_addr, info->ai_addrlen);
+    params->server_len = info->ai_addrlen;
+    freeaddrinfo(info);
+    return true;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: load [options] host\n"
+            "    -p port       server port (123, the native serve uses 12123)\n"
+            "    -r rate       requests per second (10)\n"
+            "    -c clients    sockets the requests are spread over (1)\n"
+            "    -d seconds    length of each run (10)\n"
+            "    -t ms         wait this long for late replies (1000)\n"
+            "    -s from:step:to  sweep the rate and find the knee\n"
+            "    -q / -v       less / more logging\n");
+}
+
+/*
+ * Offer NTP client requests to a server and measure what comes back.
+ */
+int load(int argc, char** argv)
+{
+    LoadParams  params;
+    const char* port  = "123";
+    bool        swept = false;
+    double      from  = 0;
+    double      step  = 0;
+    double      to    = 0;
+    int         opt;
+
+    memset(&params, 0, sizeof(params));
+    params.rate       = 10;
+    params.clients    = 1;
+    params.seconds    = 10;
+    params.timeout_ms = 1000;
+
+    while ((opt = getopt(argc, argv, "p:r:c:d:t:s:qv")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p': port              = optarg; break;
+        case 'r': params.rate       = atof(optarg); break;
+        case 'c': params.clients    = (uint32_t)atol(optarg); break;
+        case 'd': params.seconds    = (uint32_t)atol(optarg); break;
+        case 't': params.timeout_ms = (uint32_t)atol(optarg); break;
+        case 'q': dlog.setLevel(DLog::WARNING); break;
+        case 'v': dlog.setLevel(DLog::DEBUG); break;
+        case 's':
+            if (sscanf(optarg, "%lf:%lf:%lf", &from, &step, &to) != 3 || from <= 0 || step <= 0)
+            {
+                usage();
+                return 2;
+            }
+            swept = true;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (optind != argc-1 || params.rate <= 0 || params.clients == 0 || params.clients > LOAD_MAX_CLIENTS
+            || params.seconds == 0)
+    {
+        usage();
+        return 2;
+    }
+    if (!resolve(argv[optind], port, &params))
+    {
+        dlog.error(TAG, "can't resolve '%s'", argv[optind]);
+        return 1;
+    }
+
+    catchSignals();
+    if (swept)
+    {
+        return sweep(params, from, step, to);
+    }
+
+    LoadResult result = LoadResult();
+    if (!run(params, &result))
+    {
+        return 1;
+    }
+    report(result);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Mru.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 12, 2018
+ *      Author: chris.l
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "Commands.h"
+#include "Log.h"
+#include "NTP.h"
+
+static const char* TAG = "mru";
+
+#define MRU_TRIES       3       // per page before we give up
+#define MRU_PAGE        (NTP_CONTROL_MAX_DATA / sizeof(NTPMRUEntry))
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: mru [options] host\n"
+            "    -p port       server port (123, the native serve uses 12123)\n"
+            "    -t ms         wait this long for each page (1000)\n"
+            "    -v            more logging\n"
+            "the server only answers addresses with a \"query\" access rule\n");
+}
+
+/*
+ * Ask for one page of the list.  Returns the number of entries (copied to
+ * entries) or -1 if nothing came back, *more says if there are others.
+ */
+static int page(int fd, uint16_t sequence, uint32_t index, int timeout_ms, NTPMRUEntry* entries, bool* more)
+{
+    uint8_t     request[sizeof(NTPPacket)];
+    NTPControl* control = (NTPControl*)request;
+    memset(request, 0, sizeof(request));
+    control->flags    = (4 << 3) | 6;  // version 4, control
+    control->op       = NTP_CONTROL_READ_MRU;
+    control->sequence = htons(sequence);
+    control->offset   = htons((uint16_t)index);
+    if (send(fd, request, sizeof(request), 0) < 0)
+    {
+        dlog.error(TAG, "send: %s", strerror(errno));
+        return -1;
+    }
+
+    struct pollfd pfd = {fd, POLLIN, 0};
+    uint8_t       reply[sizeof(NTPControl) + NTP_CONTROL_MAX_DATA];
+    while (poll(&pfd, 1, timeout_ms) > 0)
+    {
+        ssize_t len = recv(fd, reply, sizeof(reply), 0);
+        if (len < (ssize_t)sizeof(NTPControl))
+        {
+            continue;
+        }
+
+        NTPControl header;
+        memcpy(&header, reply, sizeof(header));
+        uint16_t count = ntohs(header.count);
+        if ((header.flags & 0x07) != 6 || ntohs(header.sequence) != sequence
+                || (header.op & NTP_CONTROL_OP_MASK) != NTP_CONTROL_READ_MRU)
+        {
+            dlog.debug(TAG, "ignoring reply flags:0x%02x op:0x%02x sequence:%u", header.flags, header.op, ntohs(header.sequence));
+            continue;
+        }
+        if ((header.op & NTP_CONTROL_ERROR) || sizeof(NTPControl) + count > (size_t)len
+                || count > MRU_PAGE * sizeof(NTPMRUEntry))
+        {
+            dlog.error(TAG, "bad reply op:0x%02x count:%u length:%d", header.op, count, (int)len);
+            return -1;
+        }
+
+        memcpy(entries, reply + sizeof(NTPControl), count);
+        *more = (header.op & NTP_CONTROL_MORE) != 0;
+        return count / sizeof(NTPMRUEntry);
+    }
+    return -1;
+}
+
+/*
+ * List the clients a server has heard from, newest first.
+ */
+int mru(int argc, char** argv)
+{
+    const char* port    = "123";
+    int         timeout = 1000;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "p:t:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p': port    = optarg; break;
+        case 't': timeout = atoi(optarg); break;
+        case 'v': dlog.setLevel(DLog::DEBUG); break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (optind != argc-1)
+    {
+        usage();
+        return 2;
+    }
+
+    struct addrinfo hints;
+    struct addrinfo* info;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(argv[optind], port, &hints, &info) != 0)
+    {
+        dlog.error(TAG, "can't resolve %s", argv[optind]);
+        return 1;
+    }
+    int fd = socket(info->ai_family, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, info->ai_addr, info->ai_addrlen) < 0)
+    {
+        dlog.error(TAG, "can't reach %s: %s", argv[optind], strerror(errno));
+        freeaddrinfo(info);
+        return 1;
+    }
+    freeaddrinfo(info);
+
+    printf("%-15s %8s %8s %8s %10s %4s %3s %6s %6s\n",
+            "address", "first_s", "last_s", "count", "avgint_ms", "mode", "ver", "kods", "drops");
+
+    uint16_t sequence = (uint16_t)getpid();
+    uint32_t index    = 0;
+    bool     more     = true;
+    while (more && !stopping)
+    {
+        NTPMRUEntry entries[MRU_PAGE];
+        int         count = -1;
+        for (int tries = 0; count < 0 && tries < MRU_TRIES; ++tries)
+        {
+            count = page(fd, ++sequence, index, timeout, entries, &more);
+        }
+        if (count < 0)
+        {
+            dlog.error(TAG, "no answer for clients from %u on", index);
+            close(fd);
+            return 1;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const NTPMRUEntry& entry = entries[i];
+            struct in_addr     addr;
+            addr.s_addr = entry.addr;
+            printf("%-15s %8u %8u %8u %10u %4u %3u %6u %6u\n", inet_ntoa(addr),
+                    ntohl(entry.first), ntohl(entry.last), ntohl(entry.count), ntohl(entry.interval),
+                    entry.mode, entry.version, ntohl(entry.kods), ntohl(entry.drops));
+        }
+        index += count;
+        more   = more && count > 0;
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Record.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 8, 2018
+ *      Author: chris.l
+ */
+
+#include <poll.h>
+#include <unistd.h>
+#include "Commands.h"
+#include "Capture.h"
+#include "Log.h"
+#include "hal/posix/PosixUDPEndpoint.h"
+
+static const char* TAG = "record";
+
+#define RECORD_POLL_MS 500
+
+typedef struct recording
+{
+    FILE*    f;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t lost;
+    uint32_t bad;
+    uint16_t expected;
+} Recording;
+
+static void recordPacket(void* arg, hal::UDPPacket& packet)
+{
+    Recording*     r    = (Recording*)arg;
+    const uint8_t* data = packet.data();
+    size_t         len  = packet.length();
+    if (len < CAPTURE_PACKET_HEADER || memcmp(data, CAPTURE_MAGIC, 2) != 0)
+    {
+        ++r->bad;
+        return;
+    }
+
+    uint16_t seq = (uint16_t)(data[2] | (data[3] << 8));
+    if (r->packets != 0 && seq != r->expected)
+    {
+        uint16_t gap     = (uint16_t)(seq - r->expected);
+        uint8_t  note[3] = {CAPTURE_LOST, (uint8_t)gap, (uint8_t)(gap >> 8)};
+        fwrite(note, 1, sizeof(note), r->f);
+        r->lost += gap;
+        dlog.warning(TAG, "lost %u packets", gap);
+    }
+    r->expected = (uint16_t)(seq + 1);
+
+    fwrite(data + CAPTURE_PACKET_HEADER, 1, len - CAPTURE_PACKET_HEADER, r->f);
+    r->bytes += (uint32_t)(len - CAPTURE_PACKET_HEADER);
+    if (++r->packets == 1)
+    {
+        dlog.info(TAG, "receiving capture");
+    }
+}
+
+/*
+ * Write the capture packets from a GPS_CAPTURE build to a file.  Lost
+ * packets (sequence gaps) are noted in the file, the records in each
+ * packet are whole so the rest stays usable.
+ */
+int record(int argc, char** argv)
+{
+    uint16_t port = CAPTURE_PORT;
+    int      opt;
+
+    while ((opt = getopt(argc, argv, "p:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            port = (uint16_t)atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc-1)
+    {
+        fprintf(stderr, "usage: record [-p port] file\n");
+        return 2;
+    }
+
+    FILE* f = fopen(argv[optind], "wb");
+    if (f == nullptr)
+    {
+        dlog.error(TAG, "can't create '%s'", argv[optind]);
+        return 1;
+    }
+    fwrite(CAPTURE_FILE_MAGIC, 1, CAPTURE_FILE_HEADER, f);
+
+    hal::PosixUDPEndpoint udp;
+    if (!udp.listen(port))
+    {
+        dlog.error(TAG, "can't listen on port %u", port);
+        fclose(f);
+        return 1;
+    }
+
+    Recording recording;
+    memset(&recording, 0, sizeof(recording));
+    recording.f = f;
+    udp.onPacket(recordPacket, &recording);
+
+    dlog.info(TAG, "recording to '%s' from port %u", argv[optind], port);
+    catchSignals();
+    while (!stopping)
+    {
+        struct pollfd pfd;
+        pfd.fd     = udp.getFD();
+        pfd.events = POLLIN;
+        poll(&pfd, 1, RECORD_POLL_MS);
+        udp.process();
+    }
+
+    fclose(f);
+    dlog.info(TAG, "packets:%u bytes:%u lost:%u bad:%u", recording.packets, recording.bytes, recording.lost, recording.bad);
+    return 0;
+}
@@ -0,0 +1,357 @@
+/*
+ * Replay.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 8, 2018
+ *      Author: chris.l
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include "Replay.h"
+#include "Commands.h"
+#include "Log.h"
+#include "hal/posix/PosixClock.h"
+
+static const char* TAG = "replay";
+
+static uint64_t wallclock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+//
+// Simulated time for a (64 bit, unwrapped) cycle count, rounded up so that
+// hal::cycles() reads back exactly the recorded value.
+//
+static uint64_t cyclesToNs(uint64_t cycles)
+{
+    return (cycles * 1000 + CYCLES_PER_US - 1) / CYCLES_PER_US;
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>* data)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr)
+    {
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t  len;
+    while ((len = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        data->insert(data->end(), buffer, buffer + len);
+    }
+    fclose(f);
+    return true;
+}
+
+Replay::Replay(const char* dir, double speed) :
+    _fs(dir),
+    _config(_fs),
+    _serial(),
+    _pps(),
+    _timer(),
+    _gps(_serial, _pps, _timer, _config),
+    _speed(speed),
+    _cycles(0),
+    _last(0),
+    _started(false),
+    _start_ns(0),
+    _wall_start(0),
+    _last_ts(0),
+    _backwards(0),
+    _edges(0),
+    _bytes(0),
+    _lost(0),
+    _state(INVALID),
+    _transitions(),
+    _valid_offsets(),
+    _holdover_offsets()
+{
+}
+
+Replay::~Replay()
+{
+}
+
+void Replay::begin()
+{
+    hal::posix::setSimulated(true);
+    _config.begin();
+    _gps.begin();
+}
+
+void Replay::end()
+{
+    _gps.end();
+    _fs.format();
+}
+
+void Replay::record(const CaptureRecord& record)
+{
+    switch (record.type)
+    {
+    case CAPTURE_PPS:
+        advance(record.cycles);
+        edge();
+        ++_edges;
+        break;
+
+    case CAPTURE_DATA:
+        advance(record.cycles);
+        data(record);
+        _bytes += record.len;
+        break;
+
+    case CAPTURE_LOST:
+        _lost += record.lost;
+        dlog.warning(TAG, "%u packets lost here in the capture", record.lost);
+        break;
+    }
+}
+
+const char* Replay::getStateName(State state)
+{
+    switch (state)
+    {
+    case VALID:
+        return "valid";
+    case HOLDOVER:
+        return "holdover";
+    default:
+        return "invalid";
+    }
+}
+
+/*
+ * Run the clock (and any timers that expire on the way) up to the
+ * recorded cycle count, 32 bit values are unwrapped as we go.
+ */
+void Replay::advance(uint32_t cycles)
+{
+    if (!_started)
+    {
+        uint64_t now = hal::posix::getTime() * CYCLES_PER_US / 1000;
+        _cycles      = now + (uint32_t)(cycles - (uint32_t)now);
+        _start_ns    = cyclesToNs(_cycles);
+        _wall_start  = wallclock();
+        _started     = true;
+    }
+    else
+    {
+        _cycles += (int64_t)(int32_t)(cycles - _last);
+    }
+    _last = cycles;
+
+    uint64_t ns = cyclesToNs(_cycles);
+    uint64_t deadline;
+    while (hal::PosixTimer::next(&deadline) && deadline <= ns)
+    {
+        if (deadline > hal::posix::getTime())
+        {
+            hal::posix::setTime(deadline);
+        }
+        hal::PosixTimer::poll();
+        step();
+    }
+    if (ns > hal::posix::getTime())
+    {
+        hal::posix::setTime(ns);
+    }
+
+    if (_speed > 0 && ns > _start_ns)
+    {
+        uint64_t target = _wall_start + (uint64_t)((double)(ns - _start_ns) / _speed);
+        uint64_t now    = wallclock();
+        if (target > now)
+        {
+            struct timespec ts;
+            ts.tv_sec  = (time_t)((target - now) / 1000000000ULL);
+            ts.tv_nsec = (long)((target - now) % 1000000000ULL);
+            nanosleep(&ts, nullptr);
+        }
+    }
+}
+
+/*
+ * The clock is at the edge, which the receiver put on the second, so
+ * whatever fraction our time has now is the error GPS has built up since
+ * the last one.
+ */
+void Replay::edge()
+{
+    if (_state != INVALID)
+    {
+        Timestamp ts;
+        _gps.getTime(&ts);
+        int32_t fraction = (int32_t)(uint32_t)ts;   // -0.5 .. 0.5 seconds
+        int32_t offset   = (int32_t)(((int64_t)fraction * 1000000000) >> 32);
+        (_state == VALID ? _valid_offsets : _holdover_offsets).push_back(offset);
+    }
+    _pps.fire();
+    step();
+}
+
+void Replay::data(const CaptureRecord& record)
+{
+    uint32_t index = _serial.getWriteIndex();
+    _serial.push(record.data, record.len);
+    for (uint8_t i = 0; i < record.count; ++i)
+    {
+        _serial.addStamp(index + record.offsets[i], record.stamps[i]);
+    }
+    step();
+}
+
+/*
+ * One pass of the device's loop(), with the "time went backwards"
+ * check done on the full timestamp.
+ */
+void Replay::step()
+{
+    _gps.process();
+
+    State state = _gps.isValid() ? VALID : _gps.isHoldover() ? HOLDOVER : INVALID;
+    if (state != _state)
+    {
+        Transition t = {getSpan(), state};
+        _transitions.push_back(t);
+        _state = state;
+    }
+
+    if (state != INVALID)
+    {
+        Timestamp ts;
+        _gps.getTime(&ts);
+        if (ts < _last_ts)
+        {
+            ++_backwards;
+            dlog.warning(TAG, "time went backwards by %lu us",
+                    (unsigned long)(((_last_ts - ts) * MICROS_PER_SEC) >> 32));
+        }
+        _last_ts = ts;
+    }
+}
+
+static int32_t maxOffset(const std::vector<int32_t>& offsets)
+{
+    int32_t max = 0;
+    for (int32_t offset : offsets)
+    {
+        if (abs(offset) > max)
+        {
+            max = abs(offset);
+        }
+    }
+    return max;
+}
+
+/*
+ * Feed a capture file through GPS on a simulated clock, as fast as
+ * possible or at 'speed' times real time, and summarize what it did.
+ */
+int replay(int argc, char** argv)
+{
+    double speed = 0;
+    int    opt;
+
+    while ((opt = getopt(argc, argv, "s:qv")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            speed = atof(optarg);
+            break;
+        case 'q':
+            dlog.setLevel(DLog::WARNING);
+            break;
+        case 'v':
+            dlog.setLevel(DLog::DEBUG);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc-1)
+    {
+        fprintf(stderr, "usage: replay [-s speed] [-q] [-v] file\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> file;
+    if (!loadFile(argv[optind], &file))
+    {
+        dlog.error(TAG, "can't read '%s'", argv[optind]);
+        return 1;
+    }
+    CaptureReader reader(file.data(), file.size());
+    if (!reader.isValid())
+    {
+        dlog.error(TAG, "'%s' is not a capture file", argv[optind]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/espntp-replay-XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        dlog.error(TAG, "can't create a scratch directory");
+        return 1;
+    }
+
+    Replay run(dir, speed);
+    run.begin();
+
+    static CaptureRecord record;
+    uint32_t records = 0;
+    uint64_t start   = wallclock();
+
+    catchSignals();
+    while (!stopping && reader.next(&record))
+    {
+        ++records;
+        run.record(record);
+    }
+    if (!stopping && reader.getOffset() != file.size())
+    {
+        dlog.warning(TAG, "bad record at offset %lu, stopping", (unsigned long)reader.getOffset());
+    }
+
+    double wall = (double)(wallclock() - start) / 1e9;
+    GPS&   gps  = run.getGPS();
+    gps.logNMEAStats();
+    for (const Replay::Transition& t : run.getTransitions())
+    {
+        printf("%9.1fs %s\n", t.second, Replay::getStateName(t.state));
+    }
+    printf("records:%u edges:%u bytes:%u lost:%u span:%.1fs wall:%.3fs speedup:%.0fx\n",
+            records, run.getEdges(), run.getBytes(), run.getLost(), run.getSpan(), wall,
+            wall > 0 ? run.getSpan() / wall : 0.0);
+    printf("valid:%s valid_count:%u ttv:%u holdover_count:%u recovery_count:%u backwards:%u\n",
+            gps.isValid() ? "yes" : "no", gps.getValidCount(), gps.getTimeToValid(),
+            gps.getHoldoverCount(), gps.getRecoveryCount(), run.getBackwards());
+    printf("edge offset valid:%u max:%ldns holdover:%u max:%ldns\n",
+            (unsigned)run.getValidOffsets().size(), (long)maxOffset(run.getValidOffsets()),
+            (unsigned)run.getHoldoverOffsets().size(), (long)maxOffset(run.getHoldoverOffsets()));
+
+    run.end();
+    rmdir(dir);
+    return run.getBackwards() == 0 ? 0 : 3;
+}
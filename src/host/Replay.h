@@ -0,0 +1,106 @@
+/*
+ * Replay.h
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 8, 2018
+ *      Author: chris.l
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <vector>
+#include "Capture.h"
+#include "GPS.h"
+#include "Config.h"
+#include "hal/posix/PosixClock.h"
+#include "hal/posix/PosixTimer.h"
+#include "hal/posix/PosixSerial.h"
+#include "hal/posix/PosixPinInterrupt.h"
+#include "hal/posix/PosixFileSystem.h"
+
+//
+// Feeds capture records through GPS on a simulated clock, as fast as
+// possible or at 'speed' times real time.  Along the way it notes every
+// change between invalid, valid and holdover, and the offset of our time
+// from the nearest second at each PPS edge just before GPS sees it (the
+// receiver's edges are on the second, so that is our interpolation error).
+//
+class Replay
+{
+public:
+    typedef enum
+    {
+        INVALID,
+        VALID,
+        HOLDOVER
+    } State;
+
+    typedef struct transition
+    {
+        double   second;    // simulated seconds since the first record
+        State    state;     // what it changed to
+    } Transition;
+
+    Replay(const char* dir, double speed);
+    virtual ~Replay();
+
+    void     begin();
+    void     end();
+    void     record(const CaptureRecord& record);
+
+    GPS&     getGPS()           { return _gps; }
+    uint32_t getEdges()         { return _edges; }
+    uint32_t getBytes()         { return _bytes; }
+    uint32_t getLost()          { return _lost; }
+    uint32_t getBackwards()     { return _backwards; }
+    double   getSpan()          { return (double)(hal::posix::getTime() - _start_ns) / 1e9; }
+    const std::vector<Transition>& getTransitions() { return _transitions; }
+    const std::vector<int32_t>&    getValidOffsets()    { return _valid_offsets; }     // ns
+    const std::vector<int32_t>&    getHoldoverOffsets() { return _holdover_offsets; }  // ns
+
+    static const char* getStateName(State state);
+
+private:
+    hal::PosixFileSystem    _fs;
+    Config                  _config;
+    hal::PosixSerial        _serial;
+    hal::PosixPinInterrupt  _pps;
+    hal::PosixTimer         _timer;
+    GPS                     _gps;
+    double                  _speed;
+    uint64_t                _cycles;  // unwrapped cycles of the last record
+    uint32_t                _last;    // as recorded
+    bool                    _started;
+    uint64_t                _start_ns;
+    uint64_t                _wall_start;
+    Timestamp               _last_ts;
+    uint32_t                _backwards;
+    uint32_t                _edges;
+    uint32_t                _bytes;
+    uint32_t                _lost;
+    State                   _state;
+    std::vector<Transition> _transitions;
+    std::vector<int32_t>    _valid_offsets;
+    std::vector<int32_t>    _holdover_offsets;
+
+    void     advance(uint32_t cycles);
+    void     edge();
+    void     data(const CaptureRecord& record);
+    void     step();
+};
+
+#endif /* REPLAY_H_ */
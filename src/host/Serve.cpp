@@ -0,0 +1,152 @@
+/*
+ * Serve.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include "Commands.h"
+#include "HostPPS.h"
+#include "Log.h"
+#include "GPS.h"
+#include "NTP.h"
+#include "Config.h"
+#include "hal/posix/PosixClock.h"
+#include "hal/posix/PosixTimer.h"
+#include "hal/posix/PosixUDPEndpoint.h"
+#include "hal/posix/PosixFileSystem.h"
+
+static const char* TAG = "serve";
+
+#define SERVE_POLL_MS     100   // longest we sleep without looking at the timers
+#define SERVE_SPIN_NS     2000000 // spin (rather than sleep) this close to the second
+#define SERVE_STATUS_SECS 60
+
+static uint64_t realtime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Serve NTP from the real GPS/NTP code with the PPS taken from the host
+ * clock's second boundaries.  The answers are only as good as the host
+ * clock, this is for exercising the code not for keeping time.
+ */
+int serve(int argc, char** argv)
+{
+    const char* root   = "./fs";
+    int         offset = 12000;
+    bool        limit  = true;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "f:o:uv")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            root = optarg;
+            break;
+        case 'o':
+            offset = atoi(optarg);
+            break;
+        case 'u':
+            limit = false;  // no per-client rate limit, for load testing
+            break;
+        case 'v':
+            dlog.setLevel(DLog::DEBUG);
+            break;
+        default:
+            fprintf(stderr, "usage: serve [-f fsdir] [-o port_offset] [-u] [-v]\n");
+            return 2;
+        }
+    }
+
+    hal::PosixFileSystem   fs(root);
+    Config                 config(fs);
+    hal::PosixSerial       serial;
+    hal::PosixPinInterrupt pps_pin;
+    hal::PosixTimer        pps_timer;
+    GPS                    gps(serial, pps_pin, pps_timer, config);
+    hal::PosixUDPEndpoint  udp((uint16_t)offset);
+    NTP                    ntp(gps, udp);
+    HostPPS                receiver(pps_pin, serial);
+
+    config.begin();
+    config.load();
+    gps.setHoldoverLimit(config.getHoldoverLimit());
+    gps.begin();
+    ntp.begin();
+    ntp.setRateLimit(limit);
+    ntp.setAccess(config.getAccessRules(), config.getAccessCount());
+    if (!ntp.listen())
+    {
+        dlog.error(TAG, "can't listen on port %d", 123 + offset);
+        return 1;
+    }
+    dlog.info(TAG, "serving on port %d", 123 + offset);
+
+    catchSignals();
+
+    time_t last_second = (time_t)(realtime() / 1000000000ULL);
+    while (!stopping)
+    {
+        uint64_t now    = realtime();
+        time_t   second = (time_t)(now / 1000000000ULL);
+        if (second != last_second)
+        {
+            last_second = second;
+            receiver.pulse(second);
+            dlog.debug(TAG, "pulse %ld %lu ns late", (long)second, (unsigned long)(now % 1000000000ULL));
+            if (second % SERVE_STATUS_SECS == 0)
+            {
+                dlog.info(TAG, "valid:%s holdover:%s ppm:%.3f+/-%.3f req:%u rsp:%u kod:%u drop:%u ignore:%u ntp_cycles:%u/%u",
+                        gps.isValid() ? "yes" : "no", gps.isHoldover() ? "yes" : "no",
+                        gps.getFrequencyPPM(), gps.getFrequencyUncertainty(),
+                        ntp.getReqCount(), ntp.getRspCount(), ntp.getKoDCount(), ntp.getDropCount(), ntp.getIgnoreCount(), ntp.getCycles(), ntp.getMaxCycles());
+            }
+        }
+
+        udp.process();
+        hal::PosixTimer::poll();
+        gps.process();
+
+        //
+        // sleep (while listening for requests) until just before the next
+        // second, then spin so the edge is on time.  'left' is from the top
+        // of the loop so a second that passed meanwhile is not slept through.
+        //
+        uint64_t left = 1000000000ULL - now % 1000000000ULL;
+        if (left > SERVE_SPIN_NS)
+        {
+            struct pollfd pfd;
+            pfd.fd      = udp.getFD();
+            pfd.events  = POLLIN;
+            int timeout = (int)((left - SERVE_SPIN_NS) / 1000000);
+            poll(&pfd, 1, timeout < SERVE_POLL_MS ? timeout : SERVE_POLL_MS);
+        }
+    }
+
+    gps.end();
+    gps.logNMEAStats();
+    dlog.info(TAG, "stopped, %u requests %u responses", ntp.getReqCount(), ntp.getRspCount());
+    return 0;
+}
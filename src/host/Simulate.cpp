@@ -0,0 +1,739 @@
+/*
+ * Simulate.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 9, 2018
+ *      Author: chris.l
+ */
+
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "Commands.h"
+#include "Capture.h"
+#include "HostPPS.h"
+#include "Log.h"
+#include "GPS.h"
+#include "NTP.h"
+#include "Config.h"
+#include "RTCCheckpoint.h"
+#include "hal/RTCMemory.h"
+#include "hal/posix/PosixClock.h"
+#include "hal/posix/PosixTimer.h"
+#include "hal/posix/PosixFileSystem.h"
+
+static const char* TAG = "sim";
+
+#define SIM_EPOCH       1536364800   // true time zero, Sep 8, 2018 00:00:00 UTC
+#define SIM_NS_PER_SEC  1000000000ULL
+#define SIM_NEVER       UINT64_MAX
+#define SIM_LOOP_NS     1000000      // loop() period when not stalled (+/- 50%)
+
+//
+// Everything that describes one scenario, see usage() for the units.
+//
+typedef struct sim_params
+{
+    uint32_t seed;
+    uint32_t duration;
+    double   ppm;           // oscillator frequency error at power on
+    double   wander_ppb;    // random walk step of the frequency, each second
+    double   jitter_ns;     // PPS edge noise (receiver and interrupt latency), std deviation
+    double   missing;       // chance any one pulse is missing
+    uint32_t nmea_min_ms;   // RMC '$' after the edge, uniform between these
+    uint32_t nmea_max_ms;
+    double   stall_prob;    // chance of a loop() stall (WiFi) in any second
+    uint32_t stall_max_ms;  // stall length, uniform up to this
+    uint32_t outage_start;  // seconds after power on: no PPS and no fix
+    uint32_t outage_len;
+    double   query_rate;    // NTP requests per second (Poisson)
+} SimParams;
+
+typedef struct sim_result
+{
+    double               ttv;            // seconds from power on to valid, < 0 never
+    std::vector<int64_t> offsets;        // ns, answers while valid
+    std::vector<int64_t> holdover;       // ns, answers while in holdover
+    int64_t              holdover_end;   // ns, the last answer in holdover
+    uint32_t             queries;
+    uint32_t             unanswered;     // valid but no reply, should not happen
+    uint32_t             pulses;
+    uint32_t             stalls;
+} SimResult;
+
+//
+// The NTP server's socket, query() hands it a request and collects the
+// reply synchronously.
+//
+class SimUDPPacket : public hal::UDPPacket
+{
+public:
+    SimUDPPacket(const NTPPacket& request, NTPPacket* reply, uint32_t addr) :
+        _request(request), _reply(reply), _addr(addr), _rx_cycles(hal::cycles()), _replied(false) {}
+
+    size_t         length() override { return sizeof(_request); }
+    const uint8_t* data() override   { return (const uint8_t*)&_request; }
+    size_t         write(const uint8_t* data, size_t len) override
+    {
+        if (len != sizeof(*_reply))
+        {
+            return 0;
+        }
+        memcpy(_reply, data, len);
+        _replied = true;
+        return len;
+    }
+    uint8_t*       edit() override   { return (uint8_t*)&_request; }
+    size_t         reply() override  { return write((const uint8_t*)&_request, sizeof(_request)); }
+    uint32_t       remoteIP() override { return _addr; }
+    uint32_t       rxCycles() override { return _rx_cycles; }
+    bool           replied()         { return _replied; }
+
+private:
+    NTPPacket  _request;
+    NTPPacket* _reply;
+    uint32_t   _addr;
+    uint32_t   _rx_cycles;
+    bool       _replied;
+};
+
+class SimUDPEndpoint : public hal::UDPEndpoint
+{
+public:
+    SimUDPEndpoint() : _handler(nullptr), _arg(nullptr) {}
+
+    bool listen(uint16_t port) override { (void)port; return true; }
+    void close() override {}
+    void onPacket(hal::UDPHandler handler, void* arg) override { _handler = handler; _arg = arg; }
+
+    bool query(const NTPPacket& request, NTPPacket* reply, uint32_t addr)
+    {
+        SimUDPPacket packet(request, reply, addr);
+        if (_handler)
+        {
+            _handler(_arg, packet);
+        }
+        return packet.replied();
+    }
+
+private:
+    hal::UDPHandler _handler;
+    void*           _arg;
+};
+
+//
+// One power-on-to-end run.  True time is in ns since SIM_EPOCH, the host
+// clock behind hal::cycles() plays the ESP's crystal and runs fast or slow
+// by the (wandering) frequency error.  The GPS interrupt, serial and timer
+// paths are called at their true times, loop() (gps.process()) runs every
+// millisecond or so except during stalls.
+//
+class Simulation
+{
+public:
+    Simulation(const char* dir, const SimParams& params, FILE* trace, FILE* capture, uint32_t run) :
+        _params(params),
+        _trace(trace),
+        _capture(capture),
+        _run(run),
+        _rng(params.seed),
+        _fs(dir),
+        _config(_fs),
+        _serial(),
+        _pps(),
+        _timer(),
+        _writer(),
+        _capture_serial(_serial, _writer),
+        _capture_pps(_pps, _writer),
+        _gps(capture ? (hal::SerialPort&)_capture_serial : (hal::SerialPort&)_serial,
+             capture ? (hal::PinInterrupt&)_capture_pps : (hal::PinInterrupt&)_pps, _timer, _config),
+        _udp(),
+        _ntp(_gps, _udp),
+        _receiver(_pps, _serial),
+        _true(0),
+        _local(0),
+        _ppm(params.ppm),
+        _boot(0),
+        _next_tick(SIM_NEVER),
+        _next_pps(SIM_NEVER),
+        _next_nmea(SIM_NEVER),
+        _next_query(SIM_NEVER),
+        _next_loop(SIM_NEVER),
+        _stall_start(SIM_NEVER),
+        _stall_end(SIM_NEVER),
+        _pulse(0),
+        _sentence(0),
+        _client(0),
+        _result()
+    {
+        _result.ttv          = -1;
+        _result.holdover_end = 0;
+    }
+
+    const SimResult& run()
+    {
+        begin();
+
+        uint64_t end = _boot + (uint64_t)_params.duration * SIM_NS_PER_SEC;
+        while (!stopping && _true < end)
+        {
+            uint64_t next = std::min(std::min(_next_tick, _next_pps), std::min(std::min(_next_nmea, _next_query), _next_loop));
+            advance(next);
+
+            if (_true >= _next_tick)
+            {
+                tick();
+            }
+            if (_true >= _next_pps)
+            {
+                pulse();
+            }
+            if (_true >= _next_nmea)
+            {
+                sentences();
+            }
+            if (_true >= _next_query)
+            {
+                query(false);
+                _next_query = _true + interval();
+            }
+            if (_true >= _next_loop)
+            {
+                loop();
+            }
+        }
+
+        _gps.end();
+        _fs.format();
+        _writer.flush();
+        return _result;
+    }
+
+    GPS& getGPS() { return _gps; }
+
+private:
+    SimParams              _params;
+    FILE*                  _trace;
+    FILE*                  _capture;
+    uint32_t               _run;
+    std::mt19937_64        _rng;
+    hal::PosixFileSystem   _fs;
+    Config                 _config;
+    hal::PosixSerial       _serial;
+    hal::PosixPinInterrupt _pps;
+    hal::PosixTimer        _timer;
+    CaptureWriter          _writer;       // what GPS reads, as a GPS_CAPTURE build records it
+    CaptureSerial          _capture_serial;
+    CapturePinInterrupt    _capture_pps;
+    GPS                    _gps;
+    SimUDPEndpoint         _udp;
+    NTP                    _ntp;
+    HostPPS                _receiver;
+    uint64_t               _true;         // ns since SIM_EPOCH
+    long double            _local;        // ns on the ESP's crystal
+    double                 _ppm;          // its frequency error right now
+    uint64_t               _boot;         // _true at power on
+    uint64_t               _next_tick;    // true second boundaries
+    uint64_t               _next_pps;
+    uint64_t               _next_nmea;
+    uint64_t               _next_query;
+    uint64_t               _next_loop;
+    uint64_t               _stall_start;
+    uint64_t               _stall_end;
+    uint64_t               _pulse;        // true second of the next pulse
+    uint64_t               _sentence;     // and of the next RMC/GGA
+    uint32_t               _client;       // every query comes from a new address in 10/8
+    SimResult              _result;
+
+    double uniform(double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(_rng); }
+    double normal(double sigma)          { return sigma > 0 ? std::normal_distribution<double>(0, sigma)(_rng) : 0; }
+
+    uint64_t interval()
+    {
+        return (uint64_t)(std::exponential_distribution<double>(_params.query_rate)(_rng) * SIM_NS_PER_SEC) + 1;
+    }
+
+    /*
+     * Power on at a random point in a second with a cold RTC and no drift
+     * file.  GPS::begin() spends (simulated) time waiting for a UBX ACK
+     * that never comes, true time moves on by the same amount.
+     */
+    void begin()
+    {
+        RTCCheckpoint cold;
+        memset(&cold, 0, sizeof(cold));
+        hal::rtcWrite(RTC_CHECKPOINT_OFFSET, (uint32_t*)&cold, sizeof(cold));
+
+        hal::posix::setSimulated(true);
+        _boot  = (uint64_t)uniform(0, SIM_NS_PER_SEC);
+        _true  = _boot;
+        _local = 0;
+
+        if (_capture != nullptr)
+        {
+            FILE* f = _capture;
+            _writer.setSink([f](const uint8_t* packet, size_t len) {
+                size_t records = len - CAPTURE_PACKET_HEADER;
+                return fwrite(packet + CAPTURE_PACKET_HEADER, 1, records, f) == records;
+            });
+        }
+
+        _config.begin();
+        _config.load();
+        _gps.setHoldoverLimit(_config.getHoldoverLimit());
+        _gps.begin();
+        _ntp.begin();
+        _ntp.listen();
+
+        uint64_t local = hal::posix::getTime();
+        _true  += (uint64_t)((long double)local / rate());
+        _local  = local;
+
+        _next_tick  = (_true / SIM_NS_PER_SEC + 1) * SIM_NS_PER_SEC;
+        _pulse      = _next_tick / SIM_NS_PER_SEC;
+        _sentence   = _pulse;
+        _next_pps   = edge(_pulse);
+        _next_nmea  = arrival(_sentence);
+        _next_query = _params.query_rate > 0 ? _true + interval() : SIM_NEVER;
+        _next_loop  = _true;
+    }
+
+    long double rate() { return 1.0L + (long double)_ppm / 1000000.0L; }
+
+    void set(uint64_t true_ns, long double local_ns)
+    {
+        _true  = true_ns;
+        _local = local_ns;
+        hal::posix::setTime((uint64_t)llroundl(local_ns));
+    }
+
+    /*
+     * Move true time to 'target', firing the timers that expire on the way
+     * at the (true) time their crystal deadline passes.
+     */
+    void advance(uint64_t target)
+    {
+        target = MAX(target, _true);
+        for (;;)
+        {
+            long double local = _local + (long double)(target - _true) * rate();
+            uint64_t    deadline;
+            if (hal::PosixTimer::next(&deadline) && (long double)deadline <= local)
+            {
+                if ((long double)deadline > _local)
+                {
+                    set(_true + (uint64_t)ceill(((long double)deadline - _local) / rate()), deadline);
+                }
+                hal::PosixTimer::poll();
+                continue;
+            }
+            set(target, local);
+            return;
+        }
+    }
+
+    /*
+     * Once a true second: wander the oscillator, log the trace and maybe
+     * line up a stall.
+     */
+    void tick()
+    {
+        uint64_t second = _next_tick / SIM_NS_PER_SEC;
+        _next_tick += SIM_NS_PER_SEC;
+        _ppm       += normal(_params.wander_ppb) / 1000.0;
+
+        if (_trace != nullptr)
+        {
+            int64_t offset;
+            bool    answered = query(true, &offset);
+            fprintf(_trace, "%u,%llu,%s,%.4f,%.4f,", _run, (unsigned long long)(second - _boot / SIM_NS_PER_SEC),
+                    _gps.isValid() ? "valid" : _gps.isHoldover() ? "holdover" : "invalid", _ppm, _gps.getFrequencyPPM());
+            if (answered)
+            {
+                fprintf(_trace, "%lld\n", (long long)offset);
+            }
+            else
+            {
+                fprintf(_trace, "\n");
+            }
+        }
+
+        if (uniform(0, 1) < _params.stall_prob)
+        {
+            _stall_start = _true + (uint64_t)uniform(0, SIM_NS_PER_SEC);
+            _stall_end   = _stall_start + (uint64_t)uniform(0, _params.stall_max_ms * 1000000.0);
+            ++_result.stalls;
+        }
+    }
+
+    bool outage(uint64_t second)
+    {
+        uint64_t uptime = second - _boot / SIM_NS_PER_SEC;
+        return uptime >= _params.outage_start && uptime < (uint64_t)_params.outage_start + _params.outage_len;
+    }
+
+    uint64_t edge(uint64_t second)
+    {
+        return (uint64_t)((int64_t)(second * SIM_NS_PER_SEC) + llround(normal(_params.jitter_ns)));
+    }
+
+    uint64_t arrival(uint64_t second)
+    {
+        return second * SIM_NS_PER_SEC + (uint64_t)(uniform(_params.nmea_min_ms, _params.nmea_max_ms) * 1000000);
+    }
+
+    /*
+     * The receiver's time pulse for '_pulse', unless it is missing.
+     */
+    void pulse()
+    {
+        if (!outage(_pulse) && uniform(0, 1) >= _params.missing)
+        {
+            _pps.fire();
+            ++_result.pulses;
+        }
+        _next_pps = edge(++_pulse);
+    }
+
+    /*
+     * RMC and GGA labelling the pulse at '_sentence', without a fix
+     * during an outage.
+     */
+    void sentences()
+    {
+        _receiver.setFix(!outage(_sentence));
+        _receiver.sentences((time_t)(SIM_EPOCH + _sentence), hal::cycles());
+        _next_nmea = arrival(++_sentence);
+    }
+
+    void loop()
+    {
+        _gps.process();
+        _writer.process();
+        if (_result.ttv < 0 && _gps.isValid())
+        {
+            _result.ttv = (double)(_true - _boot) / SIM_NS_PER_SEC;
+            dlog.info(TAG, "valid after %.3f seconds", _result.ttv);
+        }
+
+        _next_loop = _true + (uint64_t)uniform(SIM_LOOP_NS / 2, SIM_LOOP_NS * 3 / 2);
+        if (_stall_start != SIM_NEVER && _next_loop >= _stall_start)
+        {
+            _next_loop   = MAX(_next_loop, _stall_end);
+            _stall_start = SIM_NEVER;
+            _stall_end   = SIM_NEVER;
+        }
+    }
+
+    Timestamp trueTime()
+    {
+        uint64_t fraction = ((_true % SIM_NS_PER_SEC) << 32) / SIM_NS_PER_SEC;
+        return TS_MAKE(toNTP(SIM_EPOCH + _true / SIM_NS_PER_SEC), fraction);
+    }
+
+    /*
+     * Ask the NTP server for the time (it arrives with no network delay)
+     * and compare its receive timestamp with true time.  We only ask once
+     * it is valid or in holdover, probes from the trace are not counted.
+     */
+    bool query(bool probe, int64_t* offset = nullptr)
+    {
+        bool holdover = _gps.isHoldover();
+        if (!_gps.isValid() && !holdover)
+        {
+            return false;  // NTP would only log that it is not valid
+        }
+
+        Timestamp now = trueTime();
+        NTPPacket request;
+        NTPPacket reply;
+        memset(&request, 0, sizeof(request));
+        request.flags              = (4 << 3) | 3;  // version 4, client
+        request.xmit_time.seconds  = htonl(TS_SECONDS(now));
+        request.xmit_time.fraction = htonl(TS_FRACTION(now));
+
+        // a crowd of clients rather than one that the rate limit would KoD
+        uint32_t addr = htonl(0x0a000000 | (++_client & 0x00ffffff));
+        bool answered = _udp.query(request, &reply, addr);
+        if (!answered)
+        {
+            if (!probe)
+            {
+                ++_result.queries;
+                ++_result.unanswered;
+            }
+            return false;
+        }
+
+        Timestamp server = TS_MAKE(ntohl(reply.recv_time.seconds), ntohl(reply.recv_time.fraction));
+        int64_t   ns     = llround((double)(int64_t)(server - now) * 1e9 / 4294967296.0);
+        if (offset != nullptr)
+        {
+            *offset = ns;
+        }
+        if (probe)
+        {
+            return true;
+        }
+
+        ++_result.queries;
+        if (holdover)
+        {
+            _result.holdover.push_back(ns);
+            _result.holdover_end = ns;
+        }
+        else
+        {
+            _result.offsets.push_back(ns);
+        }
+        return true;
+    }
+};
+
+/*
+ * Nearest rank percentile of 'sorted' (ascending), in microseconds.
+ */
+static double percentile(const std::vector<int64_t>& sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return NAN;
+    }
+    size_t rank = (size_t)ceil(p / 100.0 * (double)sorted.size());
+    return (double)sorted[rank > 0 ? rank-1 : 0] / 1000.0;
+}
+
+static std::vector<int64_t> magnitudes(const std::vector<int64_t>& offsets)
+{
+    std::vector<int64_t> abs_offsets;
+    abs_offsets.reserve(offsets.size());
+    for (int64_t offset : offsets)
+    {
+        abs_offsets.push_back(offset < 0 ? -offset : offset);
+    }
+    std::sort(abs_offsets.begin(), abs_offsets.end());
+    return abs_offsets;
+}
+
+static void writeHeader(FILE* out)
+{
+    fprintf(out, "seed,duration,ppm,wander_ppb,jitter_ns,missing,nmea_min_ms,nmea_max_ms,stall_prob,stall_max_ms,"
+            "outage_start,outage_len,query_rate,"
+            "ttv_s,queries,unanswered,pulses,stalls,"
+            "samples,mean_us,p50_us,p90_us,p99_us,p999_us,max_us,"
+            "holdover_samples,holdover_p50_us,holdover_p99_us,holdover_max_us,holdover_end_us,"
+            "valid_count,holdover_count,recovery_count\n");
+}
+
+static void writeResult(FILE* out, const SimParams& p, const SimResult& r, GPS& gps)
+{
+    double mean = 0;
+    for (int64_t offset : r.offsets)
+    {
+        mean += (double)offset;
+    }
+    mean = r.offsets.empty() ? NAN : mean / (double)r.offsets.size() / 1000.0;
+
+    std::vector<int64_t> valid    = magnitudes(r.offsets);
+    std::vector<int64_t> holdover = magnitudes(r.holdover);
+
+    fprintf(out, "%u,%u,%.3f,%.3f,%.1f,%.4f,%u,%u,%.4f,%u,%u,%u,%.2f,",
+            p.seed, p.duration, p.ppm, p.wander_ppb, p.jitter_ns, p.missing, p.nmea_min_ms, p.nmea_max_ms,
+            p.stall_prob, p.stall_max_ms, p.outage_start, p.outage_len, p.query_rate);
+    fprintf(out, "%.3f,%u,%u,%u,%u,", r.ttv, r.queries, r.unanswered, r.pulses, r.stalls);
+    fprintf(out, "%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,", (unsigned long)valid.size(), mean,
+            percentile(valid, 50), percentile(valid, 90), percentile(valid, 99), percentile(valid, 99.9),
+            percentile(valid, 100));
+    fprintf(out, "%lu,%.3f,%.3f,%.3f,%.3f,", (unsigned long)holdover.size(),
+            percentile(holdover, 50), percentile(holdover, 99), percentile(holdover, 100),
+            holdover.empty() ? NAN : (double)r.holdover_end / 1000.0);
+    fprintf(out, "%u,%u,%u\n", gps.getValidCount(), gps.getHoldoverCount(), gps.getRecoveryCount());
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: sim [options]\n"
+            "    -d seconds    length of each run (3600)\n"
+            "    -n runs       number of runs, the seed goes up by one each (1)\n"
+            "    -S seed       random seed of the first run (1)\n"
+            "    -p ppm        oscillator frequency error at power on (12.5)\n"
+            "    -w ppb        frequency random walk per second (0.5)\n"
+            "    -j ns         PPS edge jitter, standard deviation (100)\n"
+            "    -m prob       chance a pulse is missing (0.001)\n"
+            "    -N min:max    RMC delay after the edge, ms (50:400)\n"
+            "    -L prob:max   chance per second of a loop() stall and its longest, ms (0.02:200)\n"
+            "    -O start:len  seconds after power on with no PPS and no fix (duration/2:300, 0:0 none)\n"
+            "    -r rate       NTP requests per second (10)\n"
+            "    -o file       append the summary CSV to 'file' (stdout)\n"
+            "    -t file       write a per-second CSV trace to 'file'\n"
+            "    -c file       write what GPS reads in the first run to 'file' as a capture for replay\n"
+            "    -q / -v       less / more logging\n");
+}
+
+/*
+ * Run the real GPS and NTP code against a modelled crystal and receiver
+ * and report how far the answers are from true time as CSV.
+ */
+int simulate(int argc, char** argv)
+{
+    SimParams params;
+    params.seed         = 1;
+    params.duration     = 3600;
+    params.ppm          = 12.5;
+    params.wander_ppb   = 0.5;
+    params.jitter_ns    = 100;
+    params.missing      = 0.001;
+    params.nmea_min_ms  = 50;
+    params.nmea_max_ms  = 400;
+    params.stall_prob   = 0.02;
+    params.stall_max_ms = 200;
+    params.outage_start = 0;
+    params.outage_len   = 300;
+    params.query_rate   = 10;
+
+    bool        outage     = false;
+    uint32_t    runs       = 1;
+    const char* out_path   = nullptr;
+    const char* trace_path = nullptr;
+    const char* capture_path = nullptr;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "d:n:S:p:w:j:m:N:L:O:r:o:t:c:qv")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd': params.duration   = (uint32_t)atol(optarg); break;
+        case 'n': runs              = (uint32_t)atol(optarg); break;
+        case 'S': params.seed       = (uint32_t)atol(optarg); break;
+        case 'p': params.ppm        = atof(optarg); break;
+        case 'w': params.wander_ppb = atof(optarg); break;
+        case 'j': params.jitter_ns  = atof(optarg); break;
+        case 'm': params.missing    = atof(optarg); break;
+        case 'r': params.query_rate = atof(optarg); break;
+        case 'o': out_path          = optarg; break;
+        case 't': trace_path        = optarg; break;
+        case 'c': capture_path      = optarg; break;
+        case 'q': dlog.setLevel(DLog::WARNING); break;
+        case 'v': dlog.setLevel(DLog::DEBUG); break;
+        case 'N':
+            if (sscanf(optarg, "%u:%u", &params.nmea_min_ms, &params.nmea_max_ms) != 2)
+            {
+                usage();
+                return 2;
+            }
+            break;
+        case 'L':
+            if (sscanf(optarg, "%lf:%u", &params.stall_prob, &params.stall_max_ms) != 2)
+            {
+                usage();
+                return 2;
+            }
+            break;
+        case 'O':
+            if (sscanf(optarg, "%u:%u", &params.outage_start, &params.outage_len) != 2)
+            {
+                usage();
+                return 2;
+            }
+            outage = true;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (optind != argc || params.duration == 0 || params.nmea_min_ms > params.nmea_max_ms || params.nmea_max_ms >= 1000)
+    {
+        usage();
+        return 2;
+    }
+    if (!outage)
+    {
+        params.outage_start = params.duration / 2;
+    }
+
+    FILE* out = stdout;
+    if (out_path != nullptr && (out = fopen(out_path, "a")) == nullptr)
+    {
+        dlog.error(TAG, "can't open '%s'", out_path);
+        return 1;
+    }
+    if (ftell(out) <= 0)
+    {
+        writeHeader(out);
+    }
+
+    FILE* trace = nullptr;
+    if (trace_path != nullptr)
+    {
+        if ((trace = fopen(trace_path, "w")) == nullptr)
+        {
+            dlog.error(TAG, "can't open '%s'", trace_path);
+            return 1;
+        }
+        fprintf(trace, "run,second,state,osc_ppm,fll_ppm,offset_ns\n");
+    }
+
+    FILE* capture = nullptr;
+    if (capture_path != nullptr)
+    {
+        if ((capture = fopen(capture_path, "wb")) == nullptr)
+        {
+            dlog.error(TAG, "can't create '%s'", capture_path);
+            return 1;
+        }
+        fwrite(CAPTURE_FILE_MAGIC, 1, CAPTURE_FILE_HEADER, capture);
+    }
+
+    char dir[] = "/tmp/espntp-sim-XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        dlog.error(TAG, "can't create a scratch directory");
+        return 1;
+    }
+
+    catchSignals();
+    for (uint32_t run = 0; run < runs && !stopping; ++run)
+    {
+        Simulation sim(dir, params, trace, run == 0 ? capture : nullptr, run);
+        const SimResult& result = sim.run();
+        if (!stopping)
+        {
+            writeResult(out, params, result, sim.getGPS());
+            fflush(out);
+        }
+        ++params.seed;
+    }
+
+    rmdir(dir);
+    if (trace != nullptr)
+    {
+        fclose(trace);
+    }
+    if (capture != nullptr)
+    {
+        fclose(capture);
+    }
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return stopping ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 1, 2018
+ *      Author: chris.l
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include "Commands.h"
+#include "Log.h"
+
+DLog& dlog = DLog::getLog();
+
+volatile bool stopping;
+
+static const Command commands[] =
+{
+    {"serve",  serve,  "NTP server disciplined to the host clock"},
+    {"record", record, "write the capture sent by a GPS_CAPTURE build to a file"},
+    {"replay", replay, "feed a capture file through GPS"},
+    {"sim",    simulate, "measure timing accuracy against a modelled crystal and receiver"},
+    {"load",   load,   "offer NTP requests to a server and measure throughput, delay and offset"},
+    {"bench",  bench,  "time the timing and packet hot paths"},
+    {"mru",    mru,    "list the clients a server has heard from, newest first"},
+};
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    stopping = true;
+}
+
+void catchSignals()
+{
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+}
+
+#if !defined(UNIT_TEST)    // pio test links the project with each suite's own main()
+static int usage(const char* name)
+{
+    fprintf(stderr, "usage: %s <command> [options]\n\ncommands:\n", name);
+    for (const Command& command : commands)
+    {
+        fprintf(stderr, "    %-8s %s\n", command.name, command.help);
+    }
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        return usage(argv[0]);
+    }
+
+    for (const Command& command : commands)
+    {
+        if (strcmp(argv[1], command.name) == 0)
+        {
+            return command.run(argc-1, argv+1);
+        }
+    }
+    return usage(argv[0]);
+}
+#endif
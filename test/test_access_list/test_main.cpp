@@ -0,0 +1,223 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <unity.h>
+#include "AccessList.h"
+
+#define RANDOM_SETS     2000    // rule sets the brute force check tries
+#define RANDOM_ADDRS    200     // random addresses per set, on top of every range edge
+
+static AccessList* list;
+
+void setUp()
+{
+    list = new AccessList();
+}
+
+void tearDown()
+{
+    delete list;
+}
+
+static AccessAction check(uint32_t host)
+{
+    return list->check(htonl(host));
+}
+
+static AccessRule rule(const char* text)
+{
+    AccessRule r;
+    TEST_ASSERT_TRUE(AccessList::parse(text, &r));
+    return r;
+}
+
+static void test_parse_format()
+{
+    static const char* const texts[] = {
+        "0.0.0.0/0 ignore", "192.168.1.0/24 serve", "10.1.2.3/32 kod", "172.16.0.0/12 nomonitor", "127.0.0.1/32 query",
+    };
+    for (const char* text : texts)
+    {
+        char       back[ACCESS_TEXT_SIZE];
+        AccessRule r = rule(text);
+        AccessList::format(r, back, sizeof(back));
+        TEST_ASSERT_EQUAL_STRING(text, back);
+    }
+
+    AccessRule r = rule("10.1.2.3/8 kod");
+    TEST_ASSERT_EQUAL_HEX32(0x0a010203UL, r.addr);
+    TEST_ASSERT_EQUAL(8, r.prefix);
+    TEST_ASSERT_EQUAL(ACCESS_KOD, r.action);
+
+    TEST_ASSERT_FALSE(AccessList::parse("10.1.2/8 kod", &r));
+    TEST_ASSERT_FALSE(AccessList::parse("10.1.2.256/8 kod", &r));
+    TEST_ASSERT_FALSE(AccessList::parse("10.1.2.3/33 kod", &r));
+    TEST_ASSERT_FALSE(AccessList::parse("10.1.2.3/8 allow", &r));
+    TEST_ASSERT_FALSE(AccessList::parse("10.1.2.3/8", &r));
+}
+
+static void test_empty()
+{
+    TEST_ASSERT_EQUAL(1, list->getRanges());
+    TEST_ASSERT_EQUAL(ACCESS_SERVE, check(0));
+    TEST_ASSERT_EQUAL(ACCESS_SERVE, check(0xffffffffUL));
+}
+
+static void test_longest_prefix()
+{
+    AccessRule rules[] = {
+        rule("0.0.0.0/0 ignore"),
+        rule("192.168.1.0/24 serve"),
+        rule("192.168.1.99/32 nomonitor"),
+        rule("192.168.0.0/16 kod"),
+    };
+    TEST_ASSERT_TRUE(list->set(rules, sizeof(rules) / sizeof(rules[0])));
+
+    TEST_ASSERT_EQUAL(ACCESS_IGNORE,    check(0x08080808UL));   // 8.8.8.8
+    TEST_ASSERT_EQUAL(ACCESS_KOD,       check(0xc0a80201UL));   // 192.168.2.1
+    TEST_ASSERT_EQUAL(ACCESS_SERVE,     check(0xc0a80100UL));   // 192.168.1.0
+    TEST_ASSERT_EQUAL(ACCESS_SERVE,     check(0xc0a801ffUL));   // 192.168.1.255
+    TEST_ASSERT_EQUAL(ACCESS_NOMONITOR, check(0xc0a80163UL));   // 192.168.1.99
+    TEST_ASSERT_EQUAL(ACCESS_SERVE,     check(0xc0a80162UL));   // 192.168.1.98
+    TEST_ASSERT_EQUAL(ACCESS_IGNORE,    check(0xffffffffUL));
+}
+
+static void test_tie_goes_to_first()
+{
+    AccessRule rules[] = {rule("10.0.0.0/8 kod"), rule("10.0.0.0/8 serve")};
+    TEST_ASSERT_TRUE(list->set(rules, 2));
+    TEST_ASSERT_EQUAL(ACCESS_KOD, check(0x0a000001UL));
+}
+
+static void test_bad_rules()
+{
+    AccessRule rules[ACCESS_RULES_MAX + 1];
+    for (AccessRule& r : rules)
+    {
+        r = rule("10.0.0.0/8 ignore");
+    }
+    TEST_ASSERT_FALSE(list->set(rules, ACCESS_RULES_MAX + 1));
+
+    rules[0].prefix = 33;
+    TEST_ASSERT_FALSE(list->set(rules, 1));
+    rules[0].prefix = 8;
+    rules[0].action = 99;
+    TEST_ASSERT_FALSE(list->set(rules, 1));
+
+    // the old rules stay
+    TEST_ASSERT_EQUAL(ACCESS_SERVE, check(0x0a000001UL));
+}
+
+static uint32_t mask(uint8_t prefix)
+{
+    return prefix == 0 ? 0 : 0xffffffffUL << (32 - prefix);
+}
+
+//
+// The obvious way: try every rule, the longest prefix wins, the earlier
+// rule wins a tie and no match is served.
+//
+static AccessAction naive(const AccessRule* rules, unsigned count, uint32_t host)
+{
+    int          best   = -1;
+    AccessAction action = ACCESS_SERVE;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (((host ^ rules[i].addr) & mask(rules[i].prefix)) == 0 && rules[i].prefix > best)
+        {
+            best   = rules[i].prefix;
+            action = (AccessAction)rules[i].action;
+        }
+    }
+    return action;
+}
+
+static uint32_t next(uint32_t* state)   // xorshift32
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+//
+// Random rule sets, crowded into a few /8s so they nest and overlap,
+// checked against naive() at every rule's first and last address, one
+// either side of those and at random addresses.
+//
+static void test_brute_force()
+{
+    uint32_t state = 0x12345678;
+    for (int set = 0; set < RANDOM_SETS; ++set)
+    {
+        AccessRule rules[ACCESS_RULES_MAX];
+        unsigned   count = next(&state) % (ACCESS_RULES_MAX + 1);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            rules[i].addr   = ((next(&state) % 3 + 9) << 24) | (next(&state) & 0x00ffffff);
+            rules[i].prefix = (uint8_t)(next(&state) % 33);
+            rules[i].action = (uint8_t)(next(&state) % (ACCESS_QUERY + 1));
+        }
+        TEST_ASSERT_TRUE(list->set(rules, count));
+        TEST_ASSERT_TRUE(list->getRanges() <= ACCESS_RANGES_MAX);
+
+        uint32_t addrs[ACCESS_RULES_MAX * 6 + RANDOM_ADDRS];
+        unsigned naddrs = 0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            uint32_t first = rules[i].addr & mask(rules[i].prefix);
+            uint32_t last  = first | ~mask(rules[i].prefix);
+            uint32_t edges[] = {first - 1, first, first + 1, last - 1, last, last + 1};
+            for (uint32_t edge : edges)
+            {
+                addrs[naddrs++] = edge;
+            }
+        }
+        for (int i = 0; i < RANDOM_ADDRS; ++i)
+        {
+            addrs[naddrs++] = i & 1 ? next(&state) : ((next(&state) % 3 + 9) << 24) | (next(&state) & 0x00ffffff);
+        }
+
+        for (unsigned i = 0; i < naddrs; ++i)
+        {
+            if (check(addrs[i]) != naive(rules, count, addrs[i]))
+            {
+                char message[64];
+                snprintf(message, sizeof(message), "set %d: %u rules, address 0x%08x", set, count, (unsigned)addrs[i]);
+                TEST_ASSERT_EQUAL_MESSAGE(naive(rules, count, addrs[i]), check(addrs[i]), message);
+            }
+        }
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_format);
+    RUN_TEST(test_empty);
+    RUN_TEST(test_longest_prefix);
+    RUN_TEST(test_tie_goes_to_first);
+    RUN_TEST(test_bad_rules);
+    RUN_TEST(test_brute_force);
+    return UNITY_END();
+}
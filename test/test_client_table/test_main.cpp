@@ -0,0 +1,178 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <arpa/inet.h>
+#include <unity.h>
+#include "ClientTable.h"
+
+#define CLIENT(n) htonl(0x0a000000UL | (n))     // 10.0.0.n and up
+
+static ClientTable* table;
+
+void setUp()
+{
+    table = new ClientTable();
+}
+
+void tearDown()
+{
+    delete table;
+}
+
+static void test_seen()
+{
+    ClientEntry& a = table->seen(CLIENT(1), 3, 4, 1000);
+    TEST_ASSERT_EQUAL_UINT32(CLIENT(1), a.addr);
+    TEST_ASSERT_EQUAL_UINT32(1, a.requests);
+    TEST_ASSERT_EQUAL_UINT32(1000, a.first_ms);
+    TEST_ASSERT_EQUAL(3, a.mode);
+    TEST_ASSERT_EQUAL(4, a.version);
+
+    ClientEntry& again = table->seen(CLIENT(1), 3, 3, 3000);
+    TEST_ASSERT_EQUAL_PTR(&a, &again);
+    TEST_ASSERT_EQUAL_UINT32(2, a.requests);
+    TEST_ASSERT_EQUAL_UINT32(3000, a.last_ms);
+    TEST_ASSERT_EQUAL(3, a.version);
+
+    table->seen(CLIENT(1), 3, 3, 5000);
+    TEST_ASSERT_EQUAL_UINT32(2000, ClientTable::getInterval(a));
+    TEST_ASSERT_EQUAL_UINT32(1, table->getCount());
+}
+
+static void test_lru_order()
+{
+    for (uint32_t n = 1; n <= 5; ++n)
+    {
+        table->seen(CLIENT(n), 3, 4, n * 10);
+    }
+    table->seen(CLIENT(2), 3, 4, 100);    // back to the front
+
+    static const uint32_t order[] = {2, 5, 4, 3, 1};
+    const ClientEntry* entry = table->getNewest();
+    for (uint32_t n : order)
+    {
+        TEST_ASSERT_NOT_NULL(entry);
+        TEST_ASSERT_EQUAL_UINT32(CLIENT(n), entry->addr);
+        entry = table->getOlder(*entry);
+    }
+    TEST_ASSERT_NULL(entry);
+    TEST_ASSERT_EQUAL_UINT32(5, table->getCount());
+}
+
+//
+// More clients than slots: the table stays full, the list stays whole and
+// the ones heard from most recently are still there.
+//
+static void test_eviction()
+{
+    uint32_t clients = CLIENT_TABLE_SIZE * 3;
+    for (uint32_t n = 1; n <= clients; ++n)
+    {
+        table->seen(CLIENT(n), 3, 4, n);
+    }
+    TEST_ASSERT_TRUE(table->getCount() <= CLIENT_TABLE_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(clients - table->getCount(), table->getEvictions());
+
+    uint32_t listed = 0;
+    uint32_t last   = UINT32_MAX;
+    for (const ClientEntry* entry = table->getNewest(); entry != nullptr; entry = table->getOlder(*entry))
+    {
+        TEST_ASSERT_TRUE(entry->last_ms < last);   // newest first, no loops
+        last = entry->last_ms;
+        ++listed;
+    }
+    TEST_ASSERT_EQUAL_UINT32(table->getCount(), listed);
+    TEST_ASSERT_EQUAL_UINT32(CLIENT(clients), table->getNewest()->addr);
+}
+
+static void test_rate_limit()
+{
+    uint32_t now = 100000;
+    ClientEntry& client = table->seen(CLIENT(1), 3, 4, now);
+
+    // a burst is answered, then one KoD and silence
+    for (int i = 0; i < CLIENT_BURST; ++i)
+    {
+        TEST_ASSERT_TRUE(table->limit(client, now) == CLIENT_ANSWER);
+    }
+    TEST_ASSERT_TRUE(table->limit(client, now) == CLIENT_KOD);
+    TEST_ASSERT_TRUE(table->limit(client, now + 1) == CLIENT_DROP);
+    TEST_ASSERT_EQUAL_UINT32(1, client.kods);
+    TEST_ASSERT_EQUAL_UINT32(1, client.drops);
+
+    // a token comes back every interval
+    now += CLIENT_INTERVAL_MS;
+    TEST_ASSERT_TRUE(table->limit(client, now) == CLIENT_ANSWER);
+    TEST_ASSERT_TRUE(table->limit(client, now) == CLIENT_DROP);
+
+    // and the next KoD only after the KoD interval
+    now += CLIENT_KOD_INTERVAL_MS;
+    for (int i = 0; i < CLIENT_KOD_INTERVAL_MS / CLIENT_INTERVAL_MS; ++i)
+    {
+        TEST_ASSERT_TRUE(table->limit(client, now) == CLIENT_ANSWER);
+    }
+    TEST_ASSERT_TRUE(table->limit(client, now) == CLIENT_KOD);
+
+    // a client polling slower than the interval is never limited
+    ClientEntry& polite = table->seen(CLIENT(2), 3, 4, now);
+    for (int i = 0; i < 100; ++i)
+    {
+        TEST_ASSERT_TRUE(table->limit(polite, now + i * CLIENT_INTERVAL_MS) == CLIENT_ANSWER);
+    }
+}
+
+static void test_kod_budget()
+{
+    uint32_t now  = 200000;
+    uint32_t kods = 0;
+    for (uint32_t n = 1; n <= CLIENT_KOD_PER_SEC * 2; ++n)
+    {
+        ClientEntry& client = table->seen(CLIENT(n), 3, 4, now);
+        for (int i = 0; i <= CLIENT_BURST; ++i)
+        {
+            if (table->limit(client, now) == CLIENT_KOD)
+            {
+                ++kods;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(CLIENT_KOD_PER_SEC, kods);
+}
+
+static void test_reset()
+{
+    table->seen(CLIENT(1), 3, 4, 1);
+    table->reset();
+    TEST_ASSERT_EQUAL_UINT32(0, table->getCount());
+    TEST_ASSERT_NULL(table->getNewest());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_seen);
+    RUN_TEST(test_lru_order);
+    RUN_TEST(test_eviction);
+    RUN_TEST(test_rate_limit);
+    RUN_TEST(test_kod_budget);
+    RUN_TEST(test_reset);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <unity.h>
+#include "FLL.h"
+#include "Timestamp.h"
+
+#define NOMINAL 160000000UL
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_nominal()
+{
+    FLL fll(NOMINAL);
+    TEST_ASSERT_EQUAL_UINT32(NOMINAL, fll.getCyclesPerSec());
+    TEST_ASSERT_EQUAL_UINT32(FRAC_SCALE(NOMINAL), fll.getFracScale());
+    TEST_ASSERT_EQUAL_UINT32(0, fll.getSamples());
+    TEST_ASSERT_EQUAL_INT32(0, fll.getPPB());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, FLL_MAX_PPM, fll.getUncertaintyPPM());
+}
+
+static void test_converges()
+{
+    FLL fll(NOMINAL);
+    uint32_t interval = NOMINAL + 2000;     // +12.5 ppm
+
+    // a little jitter either way, it has to average out
+    for (int i = 0; i < 200; ++i)
+    {
+        TEST_ASSERT_TRUE(fll.update(interval + (i & 1 ? 16 : -16)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(FLL_MAX_WEIGHT, fll.getSamples());
+    TEST_ASSERT_UINT32_WITHIN(1, interval, fll.getCyclesPerSec());
+    TEST_ASSERT_EQUAL_UINT32(FRAC_SCALE(fll.getCyclesPerSec()), fll.getFracScale());
+    TEST_ASSERT_INT32_WITHIN(200, 12500, fll.getPPB());
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 12.5, fll.getPPM());
+    TEST_ASSERT_TRUE(fll.getUncertaintyPPM() < 0.1);
+}
+
+static void test_tracks_a_step()
+{
+    FLL fll(NOMINAL);
+    for (int i = 0; i < 100; ++i)
+    {
+        fll.update(NOMINAL);
+    }
+
+    // warm up by 1ppm, after a few time constants it follows
+    for (int i = 0; i < 5 * FLL_MAX_WEIGHT; ++i)
+    {
+        fll.update(NOMINAL + 160);
+    }
+    TEST_ASSERT_UINT32_WITHIN(2, NOMINAL + 160, fll.getCyclesPerSec());
+}
+
+static void test_rejects()
+{
+    FLL fll(NOMINAL);
+    uint32_t limit = NOMINAL / 1000000 * FLL_MAX_PPM;
+    TEST_ASSERT_TRUE(fll.update(NOMINAL + limit));
+    TEST_ASSERT_TRUE(fll.update(NOMINAL - limit));
+    TEST_ASSERT_FALSE(fll.update(NOMINAL + limit + 1));
+    TEST_ASSERT_FALSE(fll.update(2 * NOMINAL));             // a missed edge
+    TEST_ASSERT_FALSE(fll.update(NOMINAL / 2));             // an extra one
+    TEST_ASSERT_EQUAL_UINT32(3, fll.getRejected());
+    TEST_ASSERT_EQUAL_UINT32(2, fll.getSamples());
+    TEST_ASSERT_UINT32_WITHIN(1, NOMINAL, fll.getCyclesPerSec());
+}
+
+static void test_seed()
+{
+    FLL fll(NOMINAL);
+    fll.seed(-3000);                                        // -3 ppm from the drift file
+    TEST_ASSERT_EQUAL_UINT32(FLL_SEED_SAMPLES, fll.getSamples());
+    TEST_ASSERT_EQUAL_UINT32(NOMINAL - 480, fll.getCyclesPerSec());
+    TEST_ASSERT_INT32_WITHIN(1, -3000, fll.getPPB());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, FLL_SEED_PPM, fll.getUncertaintyPPM());
+
+    // a seed beyond what update() would accept is ignored
+    fll.seed((FLL_MAX_PPM + 1) * 1000);
+    TEST_ASSERT_EQUAL_UINT32(0, fll.getSamples());
+    TEST_ASSERT_EQUAL_UINT32(NOMINAL, fll.getCyclesPerSec());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_nominal);
+    RUN_TEST(test_converges);
+    RUN_TEST(test_tracks_a_step);
+    RUN_TEST(test_rejects);
+    RUN_TEST(test_seed);
+    return UNITY_END();
+}
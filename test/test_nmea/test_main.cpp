@@ -0,0 +1,165 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "NMEAParser.h"
+
+//
+// One second of output recorded from a u-blox NEO-6M (plus a ZDA), the
+// same as the benchmark's.
+//
+static const char capture[] =
+    "$GPRMC,183035.00,A,3723.46587,N,12202.26957,W,0.011,,140718,,,A*64\r\n"
+    "$GPVTG,,T,,M,0.011,N,0.020,K,A*21\r\n"
+    "$GPGGA,183035.00,3723.46587,N,12202.26957,W,1,08,1.01,15.2,M,-29.9,M,,*52\r\n"
+    "$GPGSA,A,3,10,32,14,18,11,24,20,15,,,,,1.85,1.01,1.55*03\r\n"
+    "$GPGSV,3,1,11,08,14,048,,10,56,297,31,11,15,167,29,14,44,201,33*7F\r\n"
+    "$GPGSV,3,2,11,15,14,321,25,18,63,063,35,20,37,295,28,24,20,313,23*77\r\n"
+    "$GPGSV,3,3,11,27,02,042,,32,19,245,30,51,44,183,*4F\r\n"
+    "$GPGLL,3723.46587,N,12202.26957,W,183035.00,A,A*76\r\n"
+    "$GPZDA,183035.00,14,07,2018,00,00*63\r\n";
+
+#define CAPTURE_TIME 1531593035  // 2018-07-14 18:30:35 UTC
+
+static NMEAParser* parser;
+
+void setUp()
+{
+    parser = new NMEAParser();
+}
+
+void tearDown()
+{
+    delete parser;
+}
+
+/*
+ * Feed text, returns the number of sentences completed.
+ */
+static int feed(const char* text)
+{
+    int sentences = 0;
+    while (*text)
+    {
+        if (parser->process(*text++))
+        {
+            ++sentences;
+        }
+    }
+    return sentences;
+}
+
+static void test_capture()
+{
+    TEST_ASSERT_EQUAL(3, feed(capture));             // RMC, GGA and ZDA
+    TEST_ASSERT_EQUAL_UINT32(6, parser->getSkipped());
+    TEST_ASSERT_EQUAL_UINT32(0, parser->getErrors());
+    TEST_ASSERT_TRUE(parser->getMessage() == NMEAParser::ZDA);
+    TEST_ASSERT_EQUAL_STRING("ZDA", parser->getMessageID());
+    TEST_ASSERT_TRUE(parser->hasTime());
+    TEST_ASSERT_EQUAL(CAPTURE_TIME, parser->getTime());
+    TEST_ASSERT_EQUAL(2018, parser->getYear());
+    TEST_ASSERT_TRUE(parser->isValid());
+    TEST_ASSERT_EQUAL(8, parser->getNumSatellites());
+}
+
+static void test_rmc()
+{
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,183035.00,A,3723.46587,N,12202.26957,W,0.011,,140718,,,A*64\r\n"));
+    TEST_ASSERT_TRUE(parser->getMessage() == NMEAParser::RMC);
+    TEST_ASSERT_TRUE(parser->hasTime());
+    TEST_ASSERT_EQUAL(CAPTURE_TIME, parser->getTime());
+    TEST_ASSERT_TRUE(parser->isValid());
+
+    // a GNSS talker, the first day of 2000
+    TEST_ASSERT_EQUAL(1, feed("$GNRMC,000000.00,A,3723.46587,N,12202.26957,W,0.011,,010100,,,A*7D\r\n"));
+    TEST_ASSERT_EQUAL(946684800, parser->getTime());
+
+    // no fix yet, the time is there but not valid
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,183035.00,V,,,,,,,140718,,,N*7A\r\n"));
+    TEST_ASSERT_FALSE(parser->isValid());
+    TEST_ASSERT_TRUE(parser->hasTime());
+}
+
+static void test_zda()
+{
+    TEST_ASSERT_EQUAL(1, feed("$GPZDA,235959.00,31,12,2016,00,00*63\r\n"));
+    TEST_ASSERT_TRUE(parser->hasTime());
+    TEST_ASSERT_EQUAL(1483228799, parser->getTime());
+    TEST_ASSERT_EQUAL(2016, parser->getYear());
+}
+
+static void test_gga_no_fix()
+{
+    TEST_ASSERT_EQUAL(1, feed("$GPGGA,183035.00,3723.46587,N,12202.26957,W,0,00,99.99,,,,,,*42\r\n"));
+    TEST_ASSERT_TRUE(parser->getMessage() == NMEAParser::GGA);
+    TEST_ASSERT_FALSE(parser->hasTime());
+    TEST_ASSERT_FALSE(parser->isValid());
+    TEST_ASSERT_EQUAL(0, parser->getNumSatellites());
+}
+
+static void test_bad_sentences()
+{
+    // wrong checksum
+    TEST_ASSERT_EQUAL(0, feed("$GPZDA,183035.00,14,07,2018,00,00*64\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(1, parser->getErrors());
+
+    // not hex
+    TEST_ASSERT_EQUAL(0, feed("$GPZDA,183035.00,14,07,2018,00,00*6G\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(2, parser->getErrors());
+
+    // cut short by the line end
+    TEST_ASSERT_EQUAL(0, feed("$GPZDA,183035.00,14\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(3, parser->getErrors());
+
+    // longer than any real sentence
+    char line[NMEA_SENTENCE_SIZE + 20];
+    memset(line, '0', sizeof(line));
+    memcpy(line, "$GPRMC,", 7);
+    line[sizeof(line)-1] = '\0';
+    TEST_ASSERT_EQUAL(0, feed(line));
+    TEST_ASSERT_EQUAL_UINT32(4, parser->getErrors());
+
+    // a '$' restarts, the good sentence after the junk still parses
+    TEST_ASSERT_EQUAL(1, feed("$GPZD$GPZDA,183035.00,14,07,2018,00,00*63\r\n"));
+    TEST_ASSERT_EQUAL(CAPTURE_TIME, parser->getTime());
+}
+
+static void test_days_from_civil()
+{
+    TEST_ASSERT_EQUAL_INT32(0, NMEAParser::daysFromCivil(1970, 1, 1));
+    TEST_ASSERT_EQUAL_INT32(-1, NMEAParser::daysFromCivil(1969, 12, 31));
+    TEST_ASSERT_EQUAL_INT32(11016, NMEAParser::daysFromCivil(2000, 2, 29));
+    TEST_ASSERT_EQUAL_INT32(24855, NMEAParser::daysFromCivil(2038, 1, 19));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_capture);
+    RUN_TEST(test_rmc);
+    RUN_TEST(test_zda);
+    RUN_TEST(test_gga_no_fix);
+    RUN_TEST(test_bad_sentences);
+    RUN_TEST(test_days_from_civil);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+#include <unity.h>
+#include "Log.h"
+#include "host/Replay.h"
+
+//
+// 80 simulated seconds with the PPS and NMEA gone from 40s to 55s, written
+// by "espntp sim -q -d 80 -O 40:15 -r 0 -c test/test_replay/outage.gpsc".
+//
+#define FIXTURE             "test/test_replay/outage.gpsc"
+#define VALID_OFFSET_NS     1000    // the sim's crystal is steady, GPS should track it to well under a us
+#define HOLDOVER_OFFSET_NS  10000   // a few seconds coasting on the last frequency
+
+static Replay* run;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_records()
+{
+    TEST_ASSERT_EQUAL_UINT32(63, run->getEdges());
+    TEST_ASSERT_EQUAL_UINT32(0, run->getLost());
+    TEST_ASSERT_EQUAL_UINT32(0, run->getBackwards());
+}
+
+static void test_transitions()
+{
+    const std::vector<Replay::Transition>& t = run->getTransitions();
+    TEST_ASSERT_EQUAL_UINT32(3, t.size());
+    TEST_ASSERT_EQUAL_INT(Replay::VALID, t[0].state);
+    TEST_ASSERT_EQUAL_INT(Replay::HOLDOVER, t[1].state);
+    TEST_ASSERT_EQUAL_INT(Replay::VALID, t[2].state);
+    TEST_ASSERT_TRUE(t[0].second < t[1].second && t[1].second < t[2].second);
+
+    GPS& gps = run->getGPS();
+    TEST_ASSERT_TRUE(gps.isValid());
+    TEST_ASSERT_EQUAL_UINT32(1, gps.getValidCount());
+    TEST_ASSERT_EQUAL_UINT32(1, gps.getHoldoverCount());
+    TEST_ASSERT_EQUAL_UINT32(1, gps.getRecoveryCount());
+    TEST_ASSERT_TRUE(gps.getTimeToValid() > 0 && gps.getTimeToValid() < 30);
+}
+
+static void test_offsets()
+{
+    const std::vector<int32_t>& valid    = run->getValidOffsets();
+    const std::vector<int32_t>& holdover = run->getHoldoverOffsets();
+    TEST_ASSERT_TRUE(valid.size() > 30);
+    TEST_ASSERT_TRUE(holdover.size() > 0);
+    for (int32_t offset : valid)
+    {
+        TEST_ASSERT_INT32_WITHIN(VALID_OFFSET_NS, 0, offset);
+    }
+    for (int32_t offset : holdover)
+    {
+        TEST_ASSERT_INT32_WITHIN(HOLDOVER_OFFSET_NS, 0, offset);
+    }
+}
+
+int main()
+{
+    FILE* f = fopen(FIXTURE, "rb");
+    if (f == nullptr)
+    {
+        fprintf(stderr, "can't read '%s', run from the project directory\n", FIXTURE);
+        return 1;
+    }
+    std::vector<uint8_t> file;
+    uint8_t buffer[4096];
+    size_t  len;
+    while ((len = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        file.insert(file.end(), buffer, buffer + len);
+    }
+    fclose(f);
+
+    CaptureReader reader(file.data(), file.size());
+    if (!reader.isValid())
+    {
+        fprintf(stderr, "'%s' is not a capture file\n", FIXTURE);
+        return 1;
+    }
+
+    dlog.setLevel(DLog::WARNING);
+    static CaptureRecord record;
+    char dir[] = "/tmp/espntp-test-replay-XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        return 1;
+    }
+    run = new Replay(dir, 0);
+    run->begin();
+    while (reader.next(&record))
+    {
+        run->record(record);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_records);
+    RUN_TEST(test_transitions);
+    RUN_TEST(test_offsets);
+    int result = UNITY_END();
+
+    run->end();
+    delete run;
+    rmdir(dir);
+    return result;
+}
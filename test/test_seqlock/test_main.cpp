@@ -0,0 +1,128 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include "SeqLock.h"
+
+#define STRESS_READS 2000000
+#define SEQ_WORDS    16     // big enough that a copy is several loads
+
+typedef struct seq_test
+{
+    uint32_t a;
+    uint32_t words[SEQ_WORDS];  // a ^ index, all from the same write
+} SeqTest;
+
+static SeqLock<SeqTest> lock;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void write(uint32_t n)
+{
+    SeqTest& t = lock.beginWrite();
+    t.a = n;
+    for (uint32_t i = 0; i < SEQ_WORDS; ++i)
+    {
+        t.words[i] = n ^ i;
+    }
+    lock.endWrite();
+}
+
+static bool consistent(const SeqTest& t)
+{
+    for (uint32_t i = 0; i < SEQ_WORDS; ++i)
+    {
+        if (t.words[i] != (t.a ^ i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_read_write()
+{
+    SeqTest t;
+    write(42);
+    lock.read(&t);
+    TEST_ASSERT_EQUAL_UINT32(42, t.a);
+    TEST_ASSERT_TRUE(consistent(t));
+    TEST_ASSERT_EQUAL_UINT32(42, lock.peek().a);
+    TEST_ASSERT_EQUAL_UINT32(0, lock.getRetries());
+}
+
+//
+// A writer thread publishing flat out while this one reads, every copy
+// must be whole and the values can only go forward.
+//
+static void test_stress()
+{
+    std::atomic<bool>     stop(false);
+    std::atomic<uint32_t> writes(0);
+    write(1);
+    std::thread writer([&]() {
+        for (uint32_t n = 2; !stop.load(std::memory_order_relaxed); ++n)
+        {
+            write(n);
+            writes.store(n, std::memory_order_relaxed);
+        }
+    });
+
+    uint32_t torn = 0;
+    uint32_t back = 0;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < STRESS_READS; ++i)
+    {
+        SeqTest t;
+        lock.read(&t);
+        if (!consistent(t))
+        {
+            ++torn;
+        }
+        if (t.a < last)
+        {
+            ++back;
+        }
+        last = t.a;
+    }
+    stop = true;
+    writer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, back);
+    TEST_ASSERT_TRUE(writes.load() > 1);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_read_write);
+    RUN_TEST(test_stress);
+    return UNITY_END();
+}
@@ -0,0 +1,96 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <unity.h>
+#include "Timestamp.h"
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+//
+// every microsecond survives the round trip and lands within one LSB of
+// the exact fraction
+//
+static void test_us_round_trip()
+{
+    for (uint32_t us = 0; us < MICROS_PER_SEC; ++us)
+    {
+        uint32_t frac  = us2frac(us);
+        uint32_t exact = (uint32_t)(((uint64_t)us << 32) / MICROS_PER_SEC);
+        TEST_ASSERT_UINT32_WITHIN(1, exact, frac);
+        TEST_ASSERT_EQUAL_UINT32(us, frac2us(frac));
+    }
+}
+
+static void test_frac2us_limits()
+{
+    TEST_ASSERT_EQUAL_UINT32(0, frac2us(0));
+    TEST_ASSERT_EQUAL_UINT32(500000, frac2us(0x80000000UL));
+    TEST_ASSERT_EQUAL_UINT32(MICROS_PER_SEC-1, frac2us(0xffffffffUL));   // rounds up to a second, clamped
+}
+
+static void test_ps2frac()
+{
+    TEST_ASSERT_EQUAL_INT32(0, ps2frac(0));
+    TEST_ASSERT_INT32_WITHIN(1, 4295, ps2frac(1000000));         // 1us
+    TEST_ASSERT_INT32_WITHIN(1, -4295, ps2frac(-1000000));
+    TEST_ASSERT_INT32_WITHIN(1, 215, ps2frac(50000));            // 50ns, a typical TIM-TP qErr
+}
+
+static void test_cycles2frac()
+{
+    static const uint32_t rates[] = {CYCLES_PER_SEC - 80000, CYCLES_PER_SEC, CYCLES_PER_SEC + 80000};
+    for (uint32_t cycles_per_sec : rates)
+    {
+        uint32_t scale = FRAC_SCALE(cycles_per_sec);
+        for (uint32_t cycles = 0; cycles < cycles_per_sec; cycles += 999983)
+        {
+            uint32_t exact = (uint32_t)(((uint64_t)cycles << 32) / cycles_per_sec);
+            TEST_ASSERT_UINT32_WITHIN(16, exact, cycles2frac(cycles, scale));
+        }
+    }
+}
+
+static void test_epoch()
+{
+    TEST_ASSERT_EQUAL_UINT32(SEVENTY_YEARS, toNTP(0));
+    TEST_ASSERT_EQUAL_UINT32(1531593035UL, toEPOCH(toNTP(1531593035UL)));
+
+    Timestamp ts = TS_MAKE(0xdeadbeefUL, 0x12345678UL);
+    TEST_ASSERT_EQUAL_HEX32(0xdeadbeefUL, TS_SECONDS(ts));
+    TEST_ASSERT_EQUAL_HEX32(0x12345678UL, TS_FRACTION(ts));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_us_round_trip);
+    RUN_TEST(test_frac2us_limits);
+    RUN_TEST(test_ps2frac);
+    RUN_TEST(test_cycles2frac);
+    RUN_TEST(test_epoch);
+    return UNITY_END();
+}
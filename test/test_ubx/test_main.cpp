@@ -0,0 +1,184 @@
+/*
+ * test_main.cpp
+ *
+ * Copyright 2018 Christopher B. Liebman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *  Created on: Sep 16, 2018
+ *      Author: chris.l
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "UBX.h"
+
+#define CAPTURE_TIME 1531593035  // 2018-07-14 18:30:35 UTC
+
+static UBX* ubx;
+
+void setUp()
+{
+    ubx = new UBX();
+}
+
+void tearDown()
+{
+    delete ubx;
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/*
+ * Feed bytes, returns the number of frames process() handed back.
+ */
+static int feed(const uint8_t* data, size_t len)
+{
+    int frames = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (ubx->process(data[i]))
+        {
+            ++frames;
+        }
+    }
+    return frames;
+}
+
+/*
+ * A NAV-TIMEUTC frame for 2018-07-14 18:30:35 plus nano, returns its length.
+ */
+static size_t timeUTC(uint8_t* buffer, int32_t nano, uint8_t valid)
+{
+    uint8_t payload[20];
+    memset(payload, 0, sizeof(payload));
+    put32(payload+8, (uint32_t)nano);
+    payload[12] = 2018 & 0xff;
+    payload[13] = 2018 >> 8;
+    payload[14] = 7;
+    payload[15] = 14;
+    payload[16] = 18;
+    payload[17] = 30;
+    payload[18] = 35;
+    payload[19] = valid;
+    return UBX::frame(buffer, UBX_CLASS_NAV, UBX_NAV_TIMEUTC, payload, sizeof(payload));
+}
+
+static void test_frame()
+{
+    // CFG-MSG turning GSV off, Fletcher checksum fd 15
+    static const uint8_t expect[] = {0xb5, 0x62, 0x06, 0x01, 0x03, 0x00, 0xf0, 0x03, 0x00, 0xfd, 0x15};
+    uint8_t payload[] = {UBX_CLASS_NMEA, UBX_NMEA_GSV, 0};
+    uint8_t buffer[sizeof(payload) + UBX_OVERHEAD];
+    TEST_ASSERT_EQUAL(sizeof(expect), UBX::frame(buffer, UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload)));
+    TEST_ASSERT_EQUAL_MEMORY(expect, buffer, sizeof(expect));
+
+    TEST_ASSERT_EQUAL(1, feed(buffer, sizeof(expect)));
+    TEST_ASSERT_TRUE(ubx->is(UBX_CLASS_CFG, UBX_CFG_MSG));
+    TEST_ASSERT_EQUAL(3, ubx->getLength());
+    TEST_ASSERT_EQUAL_MEMORY(payload, ubx->getPayload(), sizeof(payload));
+    TEST_ASSERT_FALSE(ubx->inFrame());
+}
+
+static void test_time_utc()
+{
+    uint8_t buffer[64];
+    time_t  time;
+    size_t  len = timeUTC(buffer, 0, 0x07);
+
+    // junk and NMEA in front of it are skipped
+    static const uint8_t junk[] = {'$', 'G', 0xb5, 0x00, 0x62};
+    TEST_ASSERT_EQUAL(0, feed(junk, sizeof(junk)));
+    TEST_ASSERT_EQUAL(1, feed(buffer, len));
+    TEST_ASSERT_TRUE(ubx->getTimeUTC(&time));
+    TEST_ASSERT_EQUAL(CAPTURE_TIME, time);
+    TEST_ASSERT_FALSE(ubx->getQuantizationError(nullptr));   // wrong message, must not touch it
+
+    // the epoch rounds to the nearest second
+    len = timeUTC(buffer, 500000000, 0x07);
+    TEST_ASSERT_EQUAL(1, feed(buffer, len));
+    TEST_ASSERT_TRUE(ubx->getTimeUTC(&time));
+    TEST_ASSERT_EQUAL(CAPTURE_TIME + 1, time);
+
+    len = timeUTC(buffer, -500000001, 0x07);
+    TEST_ASSERT_EQUAL(1, feed(buffer, len));
+    TEST_ASSERT_TRUE(ubx->getTimeUTC(&time));
+    TEST_ASSERT_EQUAL(CAPTURE_TIME - 1, time);
+
+    // UTC not valid yet
+    len = timeUTC(buffer, 0, 0x03);
+    TEST_ASSERT_EQUAL(1, feed(buffer, len));
+    TEST_ASSERT_FALSE(ubx->getTimeUTC(&time));
+    TEST_ASSERT_EQUAL_UINT32(4, ubx->getFrames());
+}
+
+static void test_quantization_error()
+{
+    uint8_t payload[16];
+    uint8_t buffer[sizeof(payload) + UBX_OVERHEAD];
+    int32_t qerr = 0;
+    memset(payload, 0, sizeof(payload));
+    put32(payload+8, (uint32_t)-4321);
+    TEST_ASSERT_EQUAL(1, feed(buffer, UBX::frame(buffer, UBX_CLASS_TIM, UBX_TIM_TP, payload, sizeof(payload))));
+    TEST_ASSERT_TRUE(ubx->getQuantizationError(&qerr));
+    TEST_ASSERT_EQUAL_INT32(-4321, qerr);
+
+    payload[14] = 0x10;     // qErr invalid
+    TEST_ASSERT_EQUAL(1, feed(buffer, UBX::frame(buffer, UBX_CLASS_TIM, UBX_TIM_TP, payload, sizeof(payload))));
+    TEST_ASSERT_FALSE(ubx->getQuantizationError(&qerr));
+}
+
+static void test_bad_checksum()
+{
+    uint8_t buffer[64];
+    size_t  len = timeUTC(buffer, 0, 0x07);
+    buffer[len-1] ^= 0x01;
+    TEST_ASSERT_EQUAL(0, feed(buffer, len));
+    buffer[len-2] ^= 0x01;
+    TEST_ASSERT_EQUAL(0, feed(buffer, len));
+    TEST_ASSERT_EQUAL_UINT32(2, ubx->getErrors());
+    TEST_ASSERT_EQUAL_UINT32(0, ubx->getFrames());
+
+    // and it is back in sync for the next one
+    len = timeUTC(buffer, 0, 0x07);
+    TEST_ASSERT_EQUAL(1, feed(buffer, len));
+}
+
+static void test_oversized()
+{
+    uint8_t payload[UBX_MAX_PAYLOAD + 10];
+    uint8_t buffer[sizeof(payload) + UBX_OVERHEAD];
+    memset(payload, 0x55, sizeof(payload));
+
+    // checked and counted, but not handed back
+    TEST_ASSERT_EQUAL(0, feed(buffer, UBX::frame(buffer, UBX_CLASS_NAV, 0x35, payload, sizeof(payload))));
+    TEST_ASSERT_EQUAL_UINT32(1, ubx->getFrames());
+    TEST_ASSERT_EQUAL_UINT32(0, ubx->getErrors());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame);
+    RUN_TEST(test_time_utc);
+    RUN_TEST(test_quantization_error);
+    RUN_TEST(test_bad_checksum);
+    RUN_TEST(test_oversized);
+    return UNITY_END();
+}